@@ -11,6 +11,9 @@ _   ._       Copyright (c) 1996-2021 Freeciv21 and Freeciv contributors.
 
 #include <QHash>
 
+// std
+#include <vector>
+
 // utility
 #include "support.h"
 #include "timing.h"
@@ -125,8 +128,20 @@ struct tile_data_cache *tile_data_cache_new();
 struct tile_data_cache *
 tile_data_cache_copy(const struct tile_data_cache *ptdc);
 
+/**
+ * Score of a city site for a player, without the parts that depend on the
+ * settler. Sites are scored again when the turn changes or when any of the
+ * inputs read from the tiles within the city radius does.
+ */
+struct site_score {
+  int turn;                // the turn the score was calculated
+  std::vector<int> inputs; // see site_inputs()
+  int total;               // city_desirability() total, -1 if unsuitable
+};
+
 struct ai_settler {
   QHash<int, const struct tile_data_cache *> *tdc_hash;
+  QHash<int, struct site_score> *site_hash;
 
 #ifdef FREECIV_DEBUG
   struct {
@@ -135,6 +150,10 @@ struct ai_settler {
     int miss;
     int save;
   } cache;
+  struct {
+    int hit;
+    int miss;
+  } site_cache;
 #endif // FREECIV_DEBUG
 };
 
@@ -652,58 +671,62 @@ static void print_cityresult(struct player *pplayer,
 }
 
 /**
-   Calculates the desire for founding a new city at 'ptile'. The citymap
-   ensures that we do not build cities too close to each other. Returns
-   nullptr if no place was found.
+   Checks whether punit may found a city at 'ptile', as far as the unit and
+   the citymap are concerned. The citymap ensures that we do not build
+   cities too close to each other.
  */
-std::unique_ptr<cityresult> city_desirability(struct ai_type *ait,
-                                              struct player *pplayer,
-                                              struct unit *punit,
-                                              struct tile *ptile)
+static bool city_site_possible(struct player *pplayer, struct unit *punit,
+                               struct tile *ptile)
 {
   struct city *pcity = tile_city(ptile);
-  struct adv_data *ai = adv_data_get(pplayer, nullptr);
-  std::unique_ptr<cityresult> cr = nullptr;
-
-  fc_assert_ret_val(punit, nullptr);
-  fc_assert_ret_val(pplayer, nullptr);
-  fc_assert_ret_val(ai, nullptr);
 
   if (!city_can_be_built_here(ptile, punit)
       || (has_handicap(pplayer, H_MAP) && !map_is_known(ptile, pplayer))) {
-    return nullptr;
+    return false;
   }
 
   // Check if another settler has taken a spot within mindist
   square_iterate(&(wld.map), ptile, game.info.citymindist - 1, tile1)
   {
     if (citymap_is_reserved(tile1)) {
-      return nullptr;
+      return false;
     }
   }
   square_iterate_end;
 
   if (adv_danger_at(punit, ptile)) {
-    return nullptr;
+    return false;
   }
 
   if (pcity
       && (city_size_get(pcity) + unit_pop_value(punit)
           > game.info.add_to_size_limit)) {
     // Can't exceed population limit.
-    return nullptr;
+    return false;
   }
 
   if (!pcity && citymap_is_reserved(ptile)) {
-    return nullptr; // reserved, go away
+    return false; // reserved, go away
   }
 
   // If (x, y) is an existing city, consider immigration
   if (pcity && city_owner(pcity) == pplayer) {
-    return nullptr;
+    return false;
   }
 
-  cr = cityresult_fill(ait, pplayer, ptile); // Burn CPU, burn!
+  return true;
+}
+
+/**
+   Calculates the desire of pplayer for a city at 'ptile', regardless of
+   the settler that would found it. Returns nullptr if the site is
+   unsuitable.
+ */
+static std::unique_ptr<cityresult> city_site_result(struct ai_type *ait,
+                                                    struct player *pplayer,
+                                                    struct tile *ptile)
+{
+  auto cr = cityresult_fill(ait, pplayer, ptile); // Burn CPU, burn!
   if (!cr) {
     // Failed to find a good spot
     return nullptr;
@@ -726,6 +749,101 @@ std::unique_ptr<cityresult> city_desirability(struct ai_type *ait,
   return cr;
 }
 
+/**
+   Calculates the desire for founding a new city at 'ptile'. The citymap
+   ensures that we do not build cities too close to each other. Returns
+   nullptr if no place was found.
+ */
+std::unique_ptr<cityresult> city_desirability(struct ai_type *ait,
+                                              struct player *pplayer,
+                                              struct unit *punit,
+                                              struct tile *ptile)
+{
+  fc_assert_ret_val(punit, nullptr);
+  fc_assert_ret_val(pplayer, nullptr);
+  fc_assert_ret_val(adv_data_get(pplayer, nullptr), nullptr);
+
+  if (!city_site_possible(pplayer, punit, ptile)) {
+    return nullptr;
+  }
+
+  return city_site_result(ait, pplayer, ptile);
+}
+
+/**
+   Returns what cityresult_fill() reads from the tiles around a site
+   without a city, besides the tile outputs that don't change during a
+   turn.
+ */
+static std::vector<int> site_inputs(const struct player *pplayer,
+                                    const struct tile *center)
+{
+  std::vector<int> inputs;
+  bool handicap = has_handicap(pplayer, H_MAP);
+
+  inputs.push_back(tile_owner(center) ? player_index(tile_owner(center))
+                                      : -1);
+  city_tile_iterate(game.info.init_city_radius_sq, center, ptile)
+  {
+    inputs.push_back(citymap_read(ptile));
+    inputs.push_back((nullptr != tile_worked(ptile) ? 1 : 0)
+                     | (handicap && !map_is_known(ptile, pplayer) ? 2 : 0));
+  }
+  city_tile_iterate_end;
+
+  return inputs;
+}
+
+/**
+   Finds the total desire of city_desirability() for punit founding a city
+   at 'ptile', without building the whole result when possible: the part
+   that doesn't depend on the settler is kept for the turn in a site score
+   field, and used again as long as its inputs are unchanged. Returns
+   false if no city should be founded there.
+ */
+static bool city_site_total(struct ai_type *ait, struct player *pplayer,
+                            struct unit *punit, struct tile *ptile,
+                            int *total)
+{
+  struct ai_plr *ai = dai_plr_data_get(ait, pplayer, nullptr);
+
+  fc_assert_ret_val(ai != nullptr, false);
+
+  if (!city_site_possible(pplayer, punit, ptile)) {
+    return false;
+  }
+
+  if (tile_city(ptile) != nullptr) {
+    // Depends on the city; these are few
+    auto cr = city_site_result(ait, pplayer, ptile);
+    if (!cr) {
+      return false;
+    }
+    *total = cr->total;
+    return true;
+  }
+
+  auto inputs = site_inputs(pplayer, ptile);
+  auto it = ai->settler->site_hash->find(tile_index(ptile));
+  if (it == ai->settler->site_hash->end() || it->turn != game.info.turn
+      || it->inputs != inputs) {
+#ifdef FREECIV_DEBUG
+    ai->settler->site_cache.miss++;
+#endif // FREECIV_DEBUG
+    auto cr = city_site_result(ait, pplayer, ptile);
+    it = ai->settler->site_hash->insert(
+        tile_index(ptile),
+        {game.info.turn, std::move(inputs), cr ? cr->total : -1});
+  } else {
+#ifdef FREECIV_DEBUG
+    ai->settler->site_cache.hit++;
+#endif // FREECIV_DEBUG
+  }
+
+  *total = it->total;
+  return *total >= 0;
+}
+
 /**
    Find nearest and best city placement in a PF iteration according to
    "parameter".  The value in "boat_cost" is both the penalty to pay for
@@ -767,29 +885,33 @@ settler_map_iterate(struct ai_type *ait, struct pf_parameter *parameter,
     }
 
     // Calculate worth
-    auto cr = city_desirability(ait, pplayer, punit, ptile);
-
-    // Check if actually found something
-    if (!cr) {
+    int total;
+    if (!city_site_total(ait, pplayer, punit, ptile, &total)) {
       continue;
     }
 
     // This algorithm punishes long treks
     turns = move_cost / parameter->move_rate;
-    cr->result = amortize(cr->total, PERFECTION * turns);
+    int result = amortize(total, PERFECTION * turns);
 
     /* Reduce want by settler cost. Easier than amortize, but still
      * weeds out very small wants. ie we create a threshold here. */
     /* We also penalise here for using a boat (either virtual or real)
      * it's crude but what isn't?
      * Settler gets used, boat can make multiple trips. */
-    cr->result -= unit_build_shield_cost_base(punit) + boat_cost / 3;
+    result -= unit_build_shield_cost_base(punit) + boat_cost / 3;
 
     // Find best spot
-    if ((!best && cr->result > 0) || (best && cr->result > best->result)) {
+    if ((!best && result > 0) || (best && result > best->result)) {
+      // Only the best spot needs the whole result
+      auto cr = city_desirability(ait, pplayer, punit, ptile);
+      if (!cr) {
+        continue;
+      }
+      cr->result = result;
+
       // save the new 'best' value.
       best = std::move(cr);
-      cr = nullptr;
       best_turn = turns;
 
       log_debug("settler map search (search): (%d,%d) %d",
@@ -950,12 +1072,15 @@ void dai_auto_settler_init(struct ai_plr *ai)
 
   ai->settler = new ai_settler[1]();
   ai->settler->tdc_hash = new QHash<int, const struct tile_data_cache *>;
+  ai->settler->site_hash = new QHash<int, struct site_score>;
 
 #ifdef FREECIV_DEBUG
   ai->settler->cache.hit = 0;
   ai->settler->cache.old = 0;
   ai->settler->cache.miss = 0;
   ai->settler->cache.save = 0;
+  ai->settler->site_cache.hit = 0;
+  ai->settler->site_cache.miss = 0;
 #endif // FREECIV_DEBUG
 }
 
@@ -1137,16 +1262,23 @@ void dai_auto_settler_reset(struct ai_type *ait, struct player *pplayer)
             ai->settler->cache.miss, ai->settler->cache.old,
             ai->settler->cache.hit);
 
+  log_debug("[aisettler site cache for %s] miss: %d, hit: %d",
+            player_name(pplayer), ai->settler->site_cache.miss,
+            ai->settler->site_cache.hit);
+
   ai->settler->cache.hit = 0;
   ai->settler->cache.old = 0;
   ai->settler->cache.miss = 0;
   ai->settler->cache.save = 0;
+  ai->settler->site_cache.hit = 0;
+  ai->settler->site_cache.miss = 0;
 #endif // FREECIV_DEBUG
 
   for (const auto *ptdc : std::as_const(*ai->settler->tdc_hash)) {
     delete[] ptdc;
   }
   ai->settler->tdc_hash->clear();
+  ai->settler->site_hash->clear();
 
   if (caller_closes) {
     dai_data_phase_finished(ait, pplayer);
@@ -1162,6 +1294,7 @@ void dai_auto_settler_free(struct ai_plr *ai)
 
   if (ai->settler) {
     delete ai->settler->tdc_hash;
+    delete ai->settler->site_hash;
     delete[] ai->settler;
   }
   ai->settler = nullptr;
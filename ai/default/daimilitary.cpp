@@ -12,6 +12,12 @@
       \____/        ********************************************************/
 
 #include <cstring>
+#include <map>
+#include <tuple>
+
+// Qt
+#include <QHash>
+#include <QSet>
 
 // utility
 #include "log.h"
@@ -62,9 +68,12 @@
 #include "daieffects.h"
 #include "daimilitary.h"
 
+struct threat_field;
+
 static int assess_danger(struct ai_type *ait, struct city *pcity,
                          const struct civ_map *dmap,
-                         player_unit_list_getter ul_cb);
+                         player_unit_list_getter ul_cb,
+                         struct threat_field *field = nullptr);
 
 /**
    Choose the best unit the city can build to defend against attacker v.
@@ -344,14 +353,127 @@ static int assess_defense_igwall(struct ai_type *ait, struct city *pcity)
   return assess_defense_backend(ait, pcity, true);
 }
 
+/**
+   Turns needed by the units of other players to reach the cities of a
+   player, within max_turns.
+
+   Reverse maps search from every unit once per city. The field searches
+   once for all cities instead, and remembers the turns at every city tile.
+   Units of the same type on the same tile share the search.
+ */
+struct threat_field {
+  const struct player *pplayer;  // owner of the cities
+  const struct player *attacker; // whose units are being assessed
+  const struct civ_map *dmap;
+  int max_turns;
+  bool omniscient;
+  QSet<const struct tile *> targets; // the city tiles
+  // (tile, attacker, type, move rate) -> (city tile index -> turns)
+  std::map<std::tuple<int, int, int, int>, QHash<int, int>> searches;
+};
+
+/**
+   Consider all city tiles of the field as attackable, as reverse maps do
+   with their target tile.
+ */
+static enum pf_action threat_get_action(const struct tile *ptile,
+                                        enum known_type known,
+                                        const struct pf_parameter *param)
+{
+  Q_UNUSED(known)
+  auto field = static_cast<const struct threat_field *>(param->data);
+
+  return (field->targets.contains(ptile) ? PF_ACTION_ATTACK
+                                         : PF_ACTION_NONE);
+}
+
+/**
+   Returns the turns needed by the unit to reach the city tile, searching
+   from the unit if it's the first query for it. Returns false if the city
+   can't be reached within the turn limit. Same parameters as
+   pf_reverse_map_unit_position().
+ */
+static bool threat_field_unit_turns(struct threat_field *field,
+                                    const struct unit *punit,
+                                    const struct tile *ptile, int *turns)
+{
+  const int move_rate = unit_move_rate(punit);
+  const auto key = std::make_tuple(
+      tile_index(unit_tile(punit)), player_index(field->attacker),
+      utype_index(unit_type_get(punit)), move_rate);
+  auto it = field->searches.find(key);
+
+  if (it == field->searches.end()) {
+    struct pf_parameter param;
+    QHash<int, int> reached;
+
+    pft_fill_reverse_parameter(&param, nullptr);
+    param.get_action = threat_get_action;
+    param.data = field;
+    param.owner = field->attacker;
+    param.omniscience = field->omniscient;
+    param.map = field->dmap;
+    param.start_tile = unit_tile(punit);
+    param.move_rate = move_rate;
+    param.moves_left_initially = move_rate;
+    param.utype = unit_type_get(punit);
+
+    struct pf_map *pfm = pf_map_new(&param);
+    const int max_cost = move_rate * (field->max_turns + 1);
+    do {
+      if (pf_map_iter_move_cost(pfm) >= max_cost) {
+        break;
+      }
+      if (field->targets.contains(pf_map_iter(pfm))) {
+        struct pf_position pos;
+
+        pf_map_iter_position(pfm, &pos);
+        reached.insert(tile_index(pos.tile), pos.turn);
+      }
+    } while (pf_map_iterate(pfm));
+    pf_map_destroy(pfm);
+
+    it = field->searches.emplace(key, std::move(reached)).first;
+  }
+
+  auto turn = it->second.constFind(tile_index(ptile));
+  if (turn == it->second.constEnd()) {
+    return false;
+  }
+  *turns = *turn;
+  return true;
+}
+
+/**
+   Returns the turns needed by the unit to reach the city, from the threat
+   field if there is one, or else from the reverse map of the city.
+ */
+static bool unit_turns_to_city(struct pf_reverse_map *pcity_map,
+                               struct threat_field *field,
+                               const struct city *pcity,
+                               const struct unit *punit, int *turns)
+{
+  if (field != nullptr) {
+    return threat_field_unit_turns(field, punit, city_tile(pcity), turns);
+  }
+
+  struct pf_position pos;
+  if (pf_reverse_map_unit_position(pcity_map, punit, &pos)) {
+    *turns = pos.turn;
+    return true;
+  }
+  return false;
+}
+
 /**
    How dangerous and far a unit is for a city?
  */
 static int assess_danger_unit(const struct city *pcity,
                               struct pf_reverse_map *pcity_map,
+                              struct threat_field *field,
                               const struct unit *punit, int *move_time)
 {
-  struct pf_position pos;
+  int turns;
   const struct unit_type *punittype = unit_type_get(punit);
   const struct tile *ptile = city_tile(pcity);
   const struct unit *ferry;
@@ -374,15 +496,15 @@ static int assess_danger_unit(const struct city *pcity,
                   / punittype->paratroopers_range);
   }
 
-  if (pf_reverse_map_unit_position(pcity_map, punit, &pos)
-      && (PF_IMPOSSIBLE_MC == *move_time || *move_time > pos.turn)) {
-    *move_time = pos.turn;
+  if (unit_turns_to_city(pcity_map, field, pcity, punit, &turns)
+      && (PF_IMPOSSIBLE_MC == *move_time || *move_time > turns)) {
+    *move_time = turns;
   }
 
   if (unit_transported(punit) && (ferry = unit_transport_get(punit))
-      && pf_reverse_map_unit_position(pcity_map, ferry, &pos)) {
-    if ((PF_IMPOSSIBLE_MC == *move_time || *move_time > pos.turn)) {
-      *move_time = pos.turn;
+      && unit_turns_to_city(pcity_map, field, pcity, ferry, &turns)) {
+    if ((PF_IMPOSSIBLE_MC == *move_time || *move_time > turns)) {
+      *move_time = turns;
       if (!can_attack_from_non_native(punittype)) {
         (*move_time)++;
       }
@@ -411,15 +533,30 @@ static int assess_danger_unit(const struct city *pcity,
    Call assess_danger() for all cities owned by pplayer.
 
    This is necessary to initialize some ai data before some ai calculations.
+   The cities share a threat field, so that the paths of enemy units are
+   searched once for all of them.
  */
 void dai_assess_danger_player(struct ai_type *ait, struct player *pplayer,
                               const struct civ_map *dmap)
 {
   // Do nothing if game is not running
   if (S_S_RUNNING == server_state()) {
+    struct threat_field field;
+
+    field.pplayer = pplayer;
+    field.attacker = nullptr;
+    field.dmap = dmap;
+    field.max_turns = player_is_cpuhog(pplayer) ? 6 : 3;
+    field.omniscient = !has_handicap(pplayer, H_MAP);
     city_list_iterate(pplayer->cities, pcity)
     {
-      (void) assess_danger(ait, pcity, dmap, nullptr);
+      field.targets.insert(city_tile(pcity));
+    }
+    city_list_iterate_end;
+
+    city_list_iterate(pplayer->cities, pcity)
+    {
+      (void) assess_danger(ait, pcity, dmap, nullptr, &field);
     }
     city_list_iterate_end;
   }
@@ -477,10 +614,14 @@ static void dai_reevaluate_building(struct city *pcity, adv_want *value,
    FIXME: Due to the nature of assess_distance, a city will only be
    afraid of a boat laden with enemies if it stands on the coast (i.e.
    is directly reachable by this boat).
+
+   If field isn't nullptr, the turns needed by enemy units to reach the
+   city are taken from it instead of a reverse map of the city.
  */
 static int assess_danger(struct ai_type *ait, struct city *pcity,
                          const struct civ_map *dmap,
-                         player_unit_list_getter ul_cb)
+                         player_unit_list_getter ul_cb,
+                         struct threat_field *field)
 {
   struct player *pplayer = city_owner(pcity);
   struct tile *ptile = city_tile(pcity);
@@ -561,7 +702,7 @@ static int assess_danger(struct ai_type *ait, struct city *pcity,
   // Check.
   players_iterate(aplayer)
   {
-    struct pf_reverse_map *pcity_map;
+    struct pf_reverse_map *pcity_map = nullptr;
     struct unit_list *units;
 
     if (!adv_is_player_dangerous(pplayer, aplayer)) {
@@ -570,8 +711,12 @@ static int assess_danger(struct ai_type *ait, struct city *pcity,
     /* Note that we still consider the units of players we are not (yet)
      * at war with. */
 
-    pcity_map = pf_reverse_map_new_for_city(pcity, aplayer, assess_turns,
-                                            omnimap, dmap);
+    if (field != nullptr) {
+      field->attacker = aplayer;
+    } else {
+      pcity_map = pf_reverse_map_new_for_city(pcity, aplayer, assess_turns,
+                                              omnimap, dmap);
+    }
 
     if (ul_cb != nullptr) {
       units = ul_cb(aplayer);
@@ -593,7 +738,7 @@ static int assess_danger(struct ai_type *ait, struct city *pcity,
       }
 
       vulnerability =
-          assess_danger_unit(pcity, pcity_map, punit, &move_time);
+          assess_danger_unit(pcity, pcity_map, field, punit, &move_time);
 
       if (PF_IMPOSSIBLE_MC == move_time) {
         continue;
@@ -646,7 +791,9 @@ static int assess_danger(struct ai_type *ait, struct city *pcity,
     }
     unit_list_iterate_end;
 
-    pf_reverse_map_destroy(pcity_map);
+    if (pcity_map != nullptr) {
+      pf_reverse_map_destroy(pcity_map);
+    }
   }
   players_iterate_end;
 
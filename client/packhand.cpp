@@ -16,6 +16,7 @@
 #include <QBitArray>
 #include <QDateTime>
 #include <cstring>
+#include <vector>
 
 // utility
 #include "bitvector.h"
@@ -3219,6 +3220,26 @@ void handle_tile_info(const struct packet_tile_info *packet)
    * case of changes in worked tiles above. */
 }
 
+/**
+   Packet tile_snapshot handler.
+ */
+void handle_tile_snapshot(const struct packet_tile_snapshot *packet)
+{
+  std::vector<packet_tile_info> tiles;
+
+  if (!tile_snapshot_decode(packet, tiles)) {
+    qCritical("Received an invalid tile snapshot.");
+    return;
+  }
+
+  for (const auto &info : tiles) {
+    // Unknown tiles are not sent otherwise
+    if (info.known != TILE_UNKNOWN) {
+      handle_tile_info(&info);
+    }
+  }
+}
+
 /**
    Received packet containing info about current scenario
  */
@@ -18,21 +18,33 @@
  */
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QImageReader>
 #include <QPixmap>
+#include <QSaveFile>
 #include <QSet>
+#include <QStandardPaths>
 #include <QString>
 #include <QVector>
+#include <algorithm> // std::count
 #include <cstdarg>
 #include <cstdlib> // exit
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include "astring.h"
 #include "bitvector.h"
 #include "capability.h"
 #include "city.h"
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "registry.h"
 #include "registry_ini.h"
@@ -200,6 +212,9 @@ struct named_sprites {
 struct specfile {
   QPixmap *big_sprite;
   char *file_name;
+  QString gfx_file; // full path of the image, empty if not found
+  bool civ2;        // the image uses the civ2 palette conventions
+  QImage image;     // decoded in advance, until big_sprite is made
 };
 
 /**
@@ -1091,35 +1106,146 @@ static QPixmap *make_error_pixmap()
 }
 
 /**
- * Loads the given graphics file (found in the data path) into a newly
- * allocated sprite. Expects civ2 format.
+ * Returns the directory where decoded graphics files are cached, or an
+ * empty string if there is none.
  */
-static QPixmap *load_civ2_gfx_file(const QString &gfx_filename)
+static QString gfx_cache_dir()
 {
-  QImage gfx;
+  auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  return dir.isEmpty() ? dir : dir + QStringLiteral("/tilesets");
+}
 
-  // We need to manipulate the palette. Unfortunately, Qt's gif image reader
-  // ignores it and gives us an RGB image. Upstream bug:
-  //    https://bugreports.qt.io/browse/QTBUG-138949
-  // We use the png reader as a workaround. This means that graphics need to
-  // be converted to png *preserving the palette*. This can be done with:
-  //    gm convert image.gif image.png
-  auto real_full_name =
-      fileinfoname(get_data_dirs(),
-                   qUtf8Printable(gfx_filename + QStringLiteral(".png")));
-  if (real_full_name.isEmpty()) {
-    qCCritical(tileset_category, "Could not find civ2 gfx \"%s.png\",",
-               qUtf8Printable(gfx_filename));
-    return make_error_pixmap();
+/**
+ * Returns the file where the decoded graphics file with the given contents
+ * is cached, or an empty string if there is no cache directory.
+ */
+static QString gfx_cache_name(const QByteArray &contents, bool civ2)
+{
+  auto dir = gfx_cache_dir();
+  if (dir.isEmpty()) {
+    return QString();
   }
 
-  if (!gfx.load(real_full_name)) {
-    // Failed
-    qCCritical(tileset_category, "Could not load graphics file \"%s\".",
-               qUtf8Printable(real_full_name));
-    return make_error_pixmap();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(contents);
+  hash.addData(civ2 ? "civ2" : "gfx");
+  return dir + QStringLiteral("/")
+         + QString::fromLatin1(hash.result().toHex())
+         + QStringLiteral(".img");
+}
+
+// Header of the decoded image cache files
+static const char GFX_CACHE_MAGIC[] = "FC21IMG2";
+// Size of the header: magic, width and height
+static const int GFX_CACHE_HEADER = sizeof(GFX_CACHE_MAGIC) - 1 + 2 * 4;
+// The least recently used files are removed above this size
+static const qint64 GFX_CACHE_MAX_SIZE = 64 * 1024 * 1024;
+
+/**
+ * Reads a decoded image from the cache. The file is mapped in memory and
+ * the image uses the mapping directly, so nothing is copied. Returns a null
+ * image if it isn't there or is damaged.
+ */
+static QImage read_gfx_cache(const QString &cache_name)
+{
+  if (cache_name.isEmpty()) {
+    return QImage();
+  }
+
+  auto file = std::make_unique<QFile>(cache_name);
+  if (!file->open(QIODevice::ReadOnly)
+      || file->size() < GFX_CACHE_HEADER) {
+    return QImage();
+  }
+
+  const uchar *data = file->map(0, file->size());
+  if (data == nullptr
+      || memcmp(data, GFX_CACHE_MAGIC, sizeof(GFX_CACHE_MAGIC) - 1) != 0) {
+    return QImage();
+  }
+  qint32 width, height;
+  memcpy(&width, data + sizeof(GFX_CACHE_MAGIC) - 1, 4);
+  memcpy(&height, data + sizeof(GFX_CACHE_MAGIC) - 1 + 4, 4);
+  if (width <= 0 || height <= 0
+      || file->size() != GFX_CACHE_HEADER + qint64(width) * height * 4) {
+    return QImage();
+  }
+
+  // Mark the file as recently used
+  file->setFileTime(QDateTime::currentDateTime(),
+                    QFileDevice::FileModificationTime);
+
+  // The mapping lives as long as the file object, which the image owns
+  file->moveToThread(nullptr);
+  auto owner = file.release();
+  return QImage(
+      data + GFX_CACHE_HEADER, width, height, width * 4,
+      QImage::Format_ARGB32_Premultiplied,
+      [](void *file) { delete static_cast<QFile *>(file); }, owner);
+}
+
+/**
+ * Stores a decoded image in the cache. Failures are not fatal: the image
+ * will be decoded again next time.
+ */
+static void write_gfx_cache(const QString &cache_name, const QImage &image)
+{
+  if (cache_name.isEmpty()
+      || !QDir().mkpath(QFileInfo(cache_name).absolutePath())) {
+    return;
+  }
+
+  QSaveFile file(cache_name);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return;
   }
 
+  // Native byte order, so that the file can be mapped
+  const qint32 size[] = {image.width(), image.height()};
+  bool ok = file.write(GFX_CACHE_MAGIC, sizeof(GFX_CACHE_MAGIC) - 1) != -1;
+  ok = ok && file.write(reinterpret_cast<const char *>(size), sizeof(size))
+                 != -1;
+  for (int y = 0; ok && y < image.height(); ++y) {
+    auto line = reinterpret_cast<const char *>(image.constScanLine(y));
+    ok = file.write(line, image.width() * 4) != -1;
+  }
+  if (ok) {
+    file.commit();
+  }
+}
+
+/**
+ * Removes the least recently used files from the cache of decoded images
+ * until it is smaller than GFX_CACHE_MAX_SIZE. Files of older versions of
+ * the tilesets are never used again and eventually go away.
+ */
+static void prune_gfx_cache()
+{
+  auto dir = gfx_cache_dir();
+  if (dir.isEmpty()) {
+    return;
+  }
+
+  // Most recently used first
+  const auto files =
+      QDir(dir).entryInfoList({QStringLiteral("*.img")}, QDir::Files,
+                              QDir::Time);
+  qint64 total = 0;
+  for (const auto &info : files) {
+    total += info.size();
+    if (total > GFX_CACHE_MAX_SIZE) {
+      log_debug("removing cached gfx file \"%s\".",
+                qUtf8Printable(info.fileName()));
+      QFile::remove(info.absoluteFilePath());
+    }
+  }
+}
+
+/**
+ * Turns the last colors of the palette of a civ2 image transparent.
+ */
+static void apply_civ2_palette(QImage &gfx, const QString &real_full_name)
+{
   // Check that we have an indexed file.
   auto palette_size = gfx.colorCount();
   if (palette_size == 0) {
@@ -1134,15 +1260,66 @@ static QPixmap *load_civ2_gfx_file(const QString &gfx_filename)
        i < palette_size; ++i) {
     gfx.setColor(i, Qt::transparent);
   }
-  return new QPixmap(QPixmap::fromImage(gfx));
 }
 
 /**
-   Loads the given graphics file (found in the data path) into a newly
-   allocated sprite.
+ * Decodes the graphics file at real_full_name, using the cache of decoded
+ * images when possible. The image is returned in the format used by the
+ * paint engines, so that making a pixmap from it doesn't convert it again.
+ * Only uses QImage, so it can be called from any thread. Returns a null
+ * image on failure.
  */
-static QPixmap *load_gfx_file(const QString &gfx_filename)
+static QImage read_gfx_image(const QString &real_full_name, bool civ2,
+                             bool *cached = nullptr)
 {
+  QFile file(real_full_name);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QImage();
+  }
+  auto contents = file.readAll();
+  auto cache_name = gfx_cache_name(contents, civ2);
+
+  auto gfx = read_gfx_cache(cache_name);
+  if (cached != nullptr) {
+    *cached = !gfx.isNull();
+  }
+  if (!gfx.isNull()) {
+    return gfx;
+  }
+
+  log_debug("decoding gfx file \"%s\".", qUtf8Printable(real_full_name));
+  auto suffix = QFileInfo(real_full_name).suffix().toLatin1();
+  if (!gfx.loadFromData(contents, suffix.constData())) {
+    return QImage();
+  }
+  if (civ2) {
+    apply_civ2_palette(gfx, real_full_name);
+  }
+  gfx.convertTo(QImage::Format_ARGB32_Premultiplied);
+
+  write_gfx_cache(cache_name, gfx);
+  return gfx;
+}
+
+/**
+ * Finds the given graphics file in the data path. Civ2 files must be png;
+ * other files can be in any supported format. Returns an empty string if
+ * the file doesn't exist.
+ */
+static QString find_gfx_file(const QString &gfx_filename, bool civ2)
+{
+  if (civ2) {
+    // We need to manipulate the palette. Unfortunately, Qt's gif image
+    // reader ignores it and gives us an RGB image. Upstream bug:
+    //    https://bugreports.qt.io/browse/QTBUG-138949
+    // We use the png reader as a workaround. This means that graphics need
+    // to be converted to png *preserving the palette*. This can be done
+    // with:
+    //    gm convert image.gif image.png
+    return fileinfoname(get_data_dirs(),
+                        gfx_filename + QStringLiteral(".png"));
+  }
+
   // Try out all supported file extensions to find one that works.
   auto supported = QImageReader::supportedImageFormats();
 
@@ -1150,38 +1327,73 @@ static QPixmap *load_gfx_file(const QString &gfx_filename)
   // it). This dramatically improves tileset loading performance on Windows.
   supported.prepend("png");
 
-  auto gfx = new QPixmap;
-
   for (auto gfx_fileext : std::as_const(supported)) {
     QString full_name =
         QStringLiteral("%1.%2").arg(gfx_filename, gfx_fileext.data());
 
-    auto real_full_name =
-        fileinfoname(get_data_dirs(), qUtf8Printable(full_name));
+    auto real_full_name = fileinfoname(get_data_dirs(), full_name);
     if (!real_full_name.isEmpty()) {
-      log_debug("trying to load gfx file \"%s\".",
-                qUtf8Printable(real_full_name));
-      if (gfx->load(real_full_name)) {
-        return gfx;
-      }
+      return real_full_name;
+    }
+  }
+
+  return QString();
+}
+
+/**
+   Loads the given graphics file (found in the data path) into a newly
+   allocated sprite.
+ */
+static QPixmap *load_gfx_file(const QString &gfx_filename)
+{
+  auto real_full_name = find_gfx_file(gfx_filename, false);
+  if (!real_full_name.isEmpty()) {
+    auto gfx = read_gfx_image(real_full_name, false);
+    if (!gfx.isNull()) {
+      return new QPixmap(QPixmap::fromImage(std::move(gfx)));
     }
   }
 
   // Failed
-  delete gfx;
   qCCritical(tileset_category, "Could not load gfx file \"%s\".",
              qUtf8Printable(gfx_filename));
   return make_error_pixmap();
 }
 
 /**
-   Ensure that the big sprite of the given spec file is loaded.
+   Decodes the images of all spec files whose big sprite isn't loaded, in
+   parallel. Pixmaps can only be made in the main thread, so the images are
+   kept until ensure_big_sprite() needs them. Returns the number of images
+   found in the cache of decoded images.
  */
-static void ensure_big_sprite(struct tileset *t, struct specfile *sf)
+static int decode_specfile_images(struct tileset *t)
 {
-  struct section_file *file;
-  const char *gfx_filename;
+  std::vector<struct specfile *> pending;
+  for (auto *sf : std::as_const(t->specfiles)) {
+    if (!sf->big_sprite && sf->image.isNull() && !sf->gfx_file.isEmpty()) {
+      pending.push_back(sf);
+    }
+  }
 
+  std::vector<char> cached(pending.size(), false);
+  fc_parallel_for(0, int(pending.size()), [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      bool hit = false;
+      pending[i]->image =
+          read_gfx_image(pending[i]->gfx_file, pending[i]->civ2, &hit);
+      cached[i] = hit;
+    }
+  });
+
+  prune_gfx_cache();
+  return int(std::count(cached.begin(), cached.end(), true));
+}
+
+/**
+   Ensure that the big sprite of the given spec file is loaded.
+ */
+static void ensure_big_sprite(struct specfile *sf)
+{
   if (sf->big_sprite) {
     // Looks like it's already loaded.
     return;
@@ -1190,31 +1402,26 @@ static void ensure_big_sprite(struct tileset *t, struct specfile *sf)
   /* Otherwise load it.  The big sprite will sometimes be freed and will have
    * to be reloaded, but most of the time it's just loaded once, the small
    * sprites are extracted, and then it's freed. */
-  if (!(file = secfile_load(sf->file_name, true))) {
-    tileset_error(t, LOG_FATAL, _("Could not open '%s':\n%s"), sf->file_name,
-                  secfile_error());
+  if (sf->gfx_file.isEmpty()) {
+    qCCritical(tileset_category,
+               "Could not find the gfx file for the spec file \"%s\".",
+               sf->file_name);
+    sf->big_sprite = make_error_pixmap();
+    return;
   }
 
-  if (!check_tilespec_capabilities(file, "spec", SPEC_CAPSTR, sf->file_name,
-                                   true)) {
-    tileset_error(t, LOG_FATAL, _("Incompatible tileset capabilities"));
+  if (sf->image.isNull()) {
+    sf->image = read_gfx_image(sf->gfx_file, sf->civ2);
   }
-
-  gfx_filename = secfile_lookup_str(file, "file.gfx");
-
-  auto mode = secfile_lookup_str_default(file, "freeciv21", "file.mode");
-  if (mode == QStringLiteral("civ2")) {
-    sf->big_sprite = load_civ2_gfx_file(gfx_filename);
-  } else {
-    sf->big_sprite = load_gfx_file(gfx_filename);
+  if (sf->image.isNull()) {
+    qCCritical(tileset_category, "Could not load graphics file \"%s\".",
+               qUtf8Printable(sf->gfx_file));
+    sf->big_sprite = make_error_pixmap();
+    return;
   }
 
-  if (!sf->big_sprite) {
-    tileset_error(t, LOG_FATAL,
-                  _("Could not load gfx file for the spec file \"%s\"."),
-                  sf->file_name);
-  }
-  secfile_destroy(file);
+  sf->big_sprite = new QPixmap(QPixmap::fromImage(std::move(sf->image)));
+  sf->image = QImage();
 }
 
 /**
@@ -1243,8 +1450,11 @@ static void scan_specfile(struct tileset *t, struct specfile *sf,
   // Currently unused
   (void) secfile_entry_lookup(file, "info.artists");
 
-  // Not used here
-  (void) secfile_entry_lookup(file, "file.gfx");
+  // The image is loaded by ensure_big_sprite()
+  sf->civ2 = (QStringLiteral("civ2")
+              == secfile_lookup_str_default(file, "freeciv21", "file.mode"));
+  sf->gfx_file =
+      find_gfx_file(secfile_lookup_str(file, "file.gfx"), sf->civ2);
 
   if ((sections = secfile_sections_by_name_prefix(file, "grid_"))) {
     section_list_iterate(sections, psection)
@@ -2327,7 +2537,7 @@ static QPixmap *load_sprite(struct tileset *t, const QString &tag_name)
         return nullptr;
       }
     } else {
-      ensure_big_sprite(t, ss->sf);
+      ensure_big_sprite(ss->sf);
 
       auto sf_w = ss->sf->big_sprite->width();
       auto sf_h = ss->sf->big_sprite->height();
@@ -2738,6 +2948,7 @@ void finish_loading_sprites(struct tileset *t)
       delete sf->big_sprite;
       sf->big_sprite = nullptr;
     }
+    sf->image = QImage();
   }
 }
 
@@ -2750,8 +2961,19 @@ void finish_loading_sprites(struct tileset *t)
 void tileset_load_tiles(struct tileset *t)
 {
   fc_assert_ret(t != nullptr);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  auto cached = decode_specfile_images(t);
+  auto decoded = timer.elapsed();
   tileset_lookup_sprite_tags(t);
   finish_loading_sprites(t);
+
+  tileset_error(t, LOG_NORMAL,
+                _("Loaded sprites in %lld ms (%lld ms decoding images, %d "
+                  "images read from the cache)."),
+                timer.elapsed(), decoded, cached);
 }
 
 /**
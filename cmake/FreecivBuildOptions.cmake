@@ -29,6 +29,10 @@ option(FREECIV_ENABLE_NLS "Enable internationalization" ON)
 
 option(FREECIV_ENABLE_WERROR "Error out on select compiler warnings" ON)
 
+# Disable to get one heap allocation per list element, e.g. for valgrind
+option(FREECIV_GENLIST_POOL "Allocate list elements from per-thread pools" ON)
+mark_as_advanced(FREECIV_GENLIST_POOL)
+
 set(FREECIV_BUG_URL "https://github.com/longturn/freeciv21/issues"
     CACHE STRING "Where to file bug reports")
 mark_as_advanced(FREECIV_BUG_URL)
@@ -38,10 +38,12 @@
 #include "unittype.h"
 
 // Qt
+#include <QHash>
 #include <QLatin1String>
 #include <QMessageLogger>
 #include <QString>
 #include <QStringLiteral>
+#include <QVector>
 #include <QtPreprocessorSupport> // Q_UNUSED
 
 // std
@@ -4220,6 +4222,16 @@ bool is_action_enabled_unit_on_self(const action_id wanted_action,
                                              unit_tile(actor_unit));
 }
 
+/**
+   The evaluations of the actor requirements of the enablers of an action,
+   shared between evaluations of the same actor against several targets.
+   Actor requirements can test the relationship to the target player, so
+   the evaluations are kept by target player.
+ */
+struct action_actor_reqs {
+  QHash<const struct player *, QVector<enum fc_tristate>> by_target_player;
+};
+
 /**
    Find out if the action is enabled, may be enabled or isn't enabled given
    what the player owning the actor knowns.
@@ -4245,19 +4257,53 @@ static enum fc_tristate action_enabled_local(
     const struct player *target_player, const struct city *target_city,
     const struct impr_type *target_building, const struct tile *target_tile,
     const struct unit *target_unit, const struct output_type *target_output,
-    const struct specialist *target_specialist)
+    const struct specialist *target_specialist,
+    struct action_actor_reqs *actor_reqs = nullptr)
 {
+  enum fc_tristate actor_result;
   enum fc_tristate current;
   enum fc_tristate result;
+  const QVector<enum fc_tristate> *actor_results = nullptr;
+  int i = 0;
+
+  if (actor_reqs != nullptr) {
+    auto it = actor_reqs->by_target_player.find(target_player);
+    if (it == actor_reqs->by_target_player.end()) {
+      QVector<enum fc_tristate> results;
+      action_enabler_list_iterate(action_enablers_for_action(wanted_action),
+                                  enabler)
+      {
+        results.append(mke_eval_reqs(
+            actor_player, actor_player, target_player, actor_city,
+            actor_building, actor_tile, actor_unit, actor_output,
+            actor_specialist, &enabler->actor_reqs, RPT_CERTAIN));
+      }
+      action_enabler_list_iterate_end;
+      it = actor_reqs->by_target_player.insert(target_player, results);
+    }
+    actor_results = &it.value();
+  }
 
   result = TRI_NO;
   action_enabler_list_iterate(action_enablers_for_action(wanted_action),
                               enabler)
   {
+    if (actor_results != nullptr) {
+      actor_result = actor_results->at(i++);
+    } else {
+      actor_result =
+          mke_eval_reqs(actor_player, actor_player, target_player,
+                        actor_city, actor_building, actor_tile, actor_unit,
+                        actor_output, actor_specialist,
+                        &enabler->actor_reqs, RPT_CERTAIN);
+    }
+    if (actor_result == TRI_NO) {
+      // The target requirements can't change that.
+      continue;
+    }
+
     current = fc_tristate_and(
-        mke_eval_reqs(actor_player, actor_player, target_player, actor_city,
-                      actor_building, actor_tile, actor_unit, actor_output,
-                      actor_specialist, &enabler->actor_reqs, RPT_CERTAIN),
+        actor_result,
         mke_eval_reqs(actor_player, target_player, actor_player, target_city,
                       target_building, target_tile, target_unit,
                       target_output, target_specialist,
@@ -4477,7 +4523,8 @@ static struct act_prob action_prob(
     const struct unit_type *target_unittype_p,
     const struct output_type *target_output,
     const struct specialist *target_specialist,
-    const struct extra_type *target_extra)
+    const struct extra_type *target_extra,
+    struct action_actor_reqs *actor_reqs = nullptr)
 {
   int known;
   struct act_prob chance;
@@ -4519,7 +4566,8 @@ static struct act_prob action_prob(
                            actor_building, actor_tile, actor_unit,
                            actor_output, actor_specialist, target_player,
                            target_city, target_building, target_tile,
-                           target_unit, target_output, target_specialist));
+                           target_unit, target_output, target_specialist,
+                           actor_reqs));
 
   switch (paction->result) {
   case ACTRES_SPY_POISON:
@@ -4761,7 +4809,8 @@ static struct act_prob action_prob(
 static struct act_prob action_prob_vs_city_full(
     const struct unit *actor_unit, const struct city *actor_home,
     const struct tile *actor_tile, const action_id act_id,
-    const struct city *target_city)
+    const struct city *target_city,
+    struct action_actor_reqs *actor_reqs = nullptr)
 {
   const struct impr_type *target_building;
   const struct unit_type *target_utype;
@@ -4819,7 +4868,8 @@ static struct act_prob action_prob_vs_city_full(
                      nullptr, actor_tile, actor_unit, nullptr, nullptr,
                      nullptr, actor_home, city_owner(target_city),
                      target_city, target_building, city_tile(target_city),
-                     nullptr, target_utype, nullptr, nullptr, nullptr);
+                     nullptr, target_utype, nullptr, nullptr, nullptr,
+                     actor_reqs);
 }
 
 /**
@@ -4842,7 +4892,8 @@ struct act_prob action_prob_vs_city(const struct unit *actor_unit,
 static struct act_prob action_prob_vs_unit_full(
     const struct unit *actor_unit, const struct city *actor_home,
     const struct tile *actor_tile, const action_id act_id,
-    const struct unit *target_unit)
+    const struct unit *target_unit,
+    struct action_actor_reqs *actor_reqs = nullptr)
 {
   if (actor_unit == nullptr || target_unit == nullptr) {
     // Can't do an action when actor or target are missing.
@@ -4881,7 +4932,7 @@ static struct act_prob action_prob_vs_unit_full(
                      nullptr, actor_home, unit_owner(target_unit),
                      tile_city(unit_tile(target_unit)), nullptr,
                      unit_tile(target_unit), target_unit, nullptr, nullptr,
-                     nullptr, nullptr);
+                     nullptr, nullptr, actor_reqs);
 }
 
 /**
@@ -4907,6 +4958,8 @@ static struct act_prob action_prob_vs_units_full(
     const struct tile *target_tile)
 {
   struct act_prob prob_all;
+  // Shared by the units at the tile.
+  struct action_actor_reqs actor_reqs;
 
   if (actor_unit == nullptr || target_tile == nullptr) {
     // Can't do an action when actor or target are missing.
@@ -5011,7 +5064,7 @@ static struct act_prob action_prob_vs_units_full(
         actor_tile, actor_unit, nullptr, nullptr, nullptr, actor_home,
         unit_owner(target_unit), tile_city(unit_tile(target_unit)), nullptr,
         unit_tile(target_unit), target_unit, nullptr, nullptr, nullptr,
-        nullptr);
+        nullptr, &actor_reqs);
 
     if (!action_prob_possible(prob_unit)) {
       // One unit makes it impossible for all units.
@@ -5062,7 +5115,8 @@ struct act_prob action_prob_vs_units(const struct unit *actor_unit,
 static struct act_prob action_prob_vs_tile_full(
     const struct unit *actor_unit, const struct city *actor_home,
     const struct tile *actor_tile, const action_id act_id,
-    const struct tile *target_tile, const struct extra_type *target_extra)
+    const struct tile *target_tile, const struct extra_type *target_extra,
+    struct action_actor_reqs *actor_reqs = nullptr)
 {
   if (actor_unit == nullptr || target_tile == nullptr) {
     // Can't do an action when actor or target are missing.
@@ -5100,7 +5154,7 @@ static struct act_prob action_prob_vs_tile_full(
                      nullptr, actor_tile, actor_unit, nullptr, nullptr,
                      nullptr, actor_home, tile_owner(target_tile),
                      tile_city(target_tile), nullptr, target_tile, nullptr,
-                     nullptr, nullptr, nullptr, target_extra);
+                     nullptr, nullptr, nullptr, target_extra, actor_reqs);
 }
 
 /**
@@ -5117,6 +5171,85 @@ struct act_prob action_prob_vs_tile(const struct unit *actor_unit,
                                   target_extra);
 }
 
+/**
+   Get the actor unit's probability of successfully performing the chosen
+   action on each of the target cities. Faster than calling
+   action_prob_vs_city() for every target since the actor requirements are
+   only evaluated once.
+ */
+QVector<struct act_prob>
+action_probs_vs_city(const struct unit *actor_unit, const action_id act_id,
+                     const QVector<const struct city *> &target_cities)
+{
+  QVector<struct act_prob> probs(target_cities.size(), ACTPROB_IMPOSSIBLE);
+  struct action_actor_reqs actor_reqs;
+
+  if (actor_unit == nullptr || !unit_can_do_action(actor_unit, act_id)) {
+    return probs;
+  }
+
+  for (int i = 0; i < target_cities.size(); i++) {
+    probs[i] = action_prob_vs_city_full(actor_unit, unit_home(actor_unit),
+                                        unit_tile(actor_unit), act_id,
+                                        target_cities[i], &actor_reqs);
+  }
+
+  return probs;
+}
+
+/**
+   Get the actor unit's probability of successfully performing the chosen
+   action on each of the target units. Faster than calling
+   action_prob_vs_unit() for every target since the actor requirements are
+   only evaluated once.
+ */
+QVector<struct act_prob>
+action_probs_vs_unit(const struct unit *actor_unit, const action_id act_id,
+                     const QVector<const struct unit *> &target_units)
+{
+  QVector<struct act_prob> probs(target_units.size(), ACTPROB_IMPOSSIBLE);
+  struct action_actor_reqs actor_reqs;
+
+  if (actor_unit == nullptr || !unit_can_do_action(actor_unit, act_id)) {
+    return probs;
+  }
+
+  for (int i = 0; i < target_units.size(); i++) {
+    probs[i] = action_prob_vs_unit_full(actor_unit, unit_home(actor_unit),
+                                        unit_tile(actor_unit), act_id,
+                                        target_units[i], &actor_reqs);
+  }
+
+  return probs;
+}
+
+/**
+   Get the actor unit's probability of successfully performing the chosen
+   action on each of the target tiles. Faster than calling
+   action_prob_vs_tile() for every target since the actor requirements are
+   only evaluated once.
+ */
+QVector<struct act_prob>
+action_probs_vs_tile(const struct unit *actor_unit, const action_id act_id,
+                     const QVector<const struct tile *> &target_tiles,
+                     const struct extra_type *target_extra)
+{
+  QVector<struct act_prob> probs(target_tiles.size(), ACTPROB_IMPOSSIBLE);
+  struct action_actor_reqs actor_reqs;
+
+  if (actor_unit == nullptr || !unit_can_do_action(actor_unit, act_id)) {
+    return probs;
+  }
+
+  for (int i = 0; i < target_tiles.size(); i++) {
+    probs[i] = action_prob_vs_tile_full(
+        actor_unit, unit_home(actor_unit), unit_tile(actor_unit), act_id,
+        target_tiles[i], target_extra, &actor_reqs);
+  }
+
+  return probs;
+}
+
 /**
    Get the actor unit's probability of successfully performing the chosen
    action on itself.
@@ -7014,23 +7147,34 @@ struct city *action_tgt_city(struct unit *actor, struct tile *target_tile,
 }
 
 /**
- * Returns TRUE iff, from the point of view of the owner of the actor unit,
- * it looks like the actor unit may be able to do any action to the target
- * unit.
+ * Find a unit to target for an action at the specified tile.
  *
- * If the owner of the actor unit doesn't have the knowledge needed to know
- * for sure if the unit can act TRUE will be returned.
+ * Returns the first unit found at the tile that the actor may act against
+ * or nullptr if no proper target is found.
  *
  * If the only action(s) that can be performed against a target has the
  * rare_pop_up property the target will only be considered valid if the
  * accept_all_actions argument is TRUE.
  */
-static bool may_unit_act_vs_unit(struct unit *actor, struct unit *target,
-                                 bool accept_all_actions)
+struct unit *action_tgt_unit(struct unit *actor, struct tile *target_tile,
+                             bool accept_all_actions)
 {
-  if (actor == nullptr || target == nullptr) {
-    // Can't do any actions if actor or target are missing.
-    return false;
+  QVector<const struct unit *> targets;
+  int first = -1;
+
+  if (actor == nullptr) {
+    // Can't do any actions if the actor is missing.
+    return nullptr;
+  }
+
+  unit_list_iterate(target_tile->units, target)
+  {
+    targets.append(target);
+  }
+  unit_list_iterate_end;
+
+  if (targets.isEmpty()) {
+    return nullptr;
   }
 
   action_iterate(act)
@@ -7046,39 +7190,26 @@ static bool may_unit_act_vs_unit(struct unit *actor, struct unit *target,
       continue;
     }
 
-    if (action_prob_possible(action_prob_vs_unit(actor, act, target))) {
-      /* The actor unit may be able to do this action to the target
-       * unit. */
-      return true;
+    // Only the units before the best candidate so far are of interest.
+    const auto probs = action_probs_vs_unit(
+        actor, act, first < 0 ? targets : targets.mid(0, first));
+    for (int i = 0; i < probs.size(); i++) {
+      if (action_prob_possible(probs[i])) {
+        /* The actor unit may be able to do this action to the target
+         * unit. */
+        first = i;
+        break;
+      }
     }
-  }
-  action_iterate_end;
 
-  return false;
-}
-
-/**
- * Find a unit to target for an action at the specified tile.
- *
- * Returns the first unit found at the tile that the actor may act against
- * or nullptr if no proper target is found.
- *
- * If the only action(s) that can be performed against a target has the
- * rare_pop_up property the target will only be considered valid if the
- * accept_all_actions argument is TRUE.
- */
-struct unit *action_tgt_unit(struct unit *actor, struct tile *target_tile,
-                             bool accept_all_actions)
-{
-  unit_list_iterate(target_tile->units, target)
-  {
-    if (may_unit_act_vs_unit(actor, target, accept_all_actions)) {
-      return target;
+    if (first == 0) {
+      // No better target is possible.
+      break;
     }
   }
-  unit_list_iterate_end;
+  action_iterate_end;
 
-  return nullptr;
+  return first < 0 ? nullptr : const_cast<struct unit *>(targets[first]);
 }
 
 /**
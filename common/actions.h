@@ -11,6 +11,7 @@
 #include "requirements.h" // struct requirement_vector
 
 // Qt
+#include <QVector>
 class QString;
 
 /* A battle is against a defender that tries to stop the action where the
@@ -450,6 +451,19 @@ struct act_prob action_prob_vs_tile(const struct unit *actor,
 struct act_prob action_prob_self(const struct unit *actor,
                                  const action_id act_id);
 
+QVector<struct act_prob>
+action_probs_vs_city(const struct unit *actor, const action_id act_id,
+                     const QVector<const struct city *> &victims);
+
+QVector<struct act_prob>
+action_probs_vs_unit(const struct unit *actor, const action_id act_id,
+                     const QVector<const struct unit *> &victims);
+
+QVector<struct act_prob>
+action_probs_vs_tile(const struct unit *actor, const action_id act_id,
+                     const QVector<const struct tile *> &victims,
+                     const struct extra_type *target_extra);
+
 struct act_prob action_prob_unit_vs_tgt(const struct action *paction,
                                         const struct unit *act_unit,
                                         const struct city *tgt_city,
@@ -200,6 +200,12 @@ BV_DEFINE(bv_startpos_nations, MAX_NUM_STARTPOS_NATIONS);
  */
 #define ATTRIBUTE_CHUNK_SIZE (1400)
 
+/*
+ * Maximum size of the encoded tiles in a PACKET_TILE_SNAPSHOT. The whole
+ * packet must fit in MAX_LEN_PACKET.
+ */
+#define TILE_SNAPSHOT_SIZE (4000)
+
 /**
  * Network / Packet - types
  */
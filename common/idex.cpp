@@ -6,14 +6,9 @@
  * idex = ident index: a lookup table for quick mapping of unit and city
  * id values to unit and city pointers.
  *
- * Method: use separate hash tables for each type.
- * Means code duplication for city/unit cases, but simplicity advantages.
- * Don't have to manage memory at all: store pointers to unit and city
- * structs allocated elsewhere, and keys are pointers to id values inside
- * the structs.
- *
- * Note id values should probably be unsigned int: here leave as plain int
- * so can use pointers to pcity->id etc.
+ * Method: use a separate idex_table for each type, indexed directly by id
+ * since ids are small dense integers.  Don't have to manage memory at
+ * all: store pointers to unit and city structs allocated elsewhere.
  */
 
 // self
@@ -28,20 +23,17 @@
 #include "unittype.h"
 #include "world_object.h"
 
-// Qt
-#include <QHash>
-
 /**
     Initialize.  Should call this at the start before use.
  */
 void idex_init(struct world *iworld)
 {
-  iworld->cities = new QHash<int, const struct city *>;
-  iworld->units = new QHash<int, const struct unit *>;
+  iworld->cities = new idex_table<struct city>;
+  iworld->units = new idex_table<struct unit>;
 }
 
 /**
-    Free the hashs.
+    Free the tables.
  */
 void idex_free(struct world *iworld)
 {
@@ -57,15 +49,12 @@ void idex_free(struct world *iworld)
  */
 void idex_register_city(struct world *iworld, struct city *pcity)
 {
-  const struct city *old;
-
-  if (iworld->cities->contains(pcity->id)) {
-    old = iworld->cities->value(pcity->id);
-    fc_assert_ret_msg(nullptr == old,
-                      "IDEX: city collision: new %d %p %s, old %d %p %s",
-                      pcity->id, (void *) pcity, city_name_get(pcity),
-                      old->id, (void *) old, city_name_get(old));
-  }
+  const struct city *old = iworld->cities->lookup(pcity->id);
+
+  fc_assert_ret_msg(nullptr == old,
+                    "IDEX: city collision: new %d %p %s, old %d %p %s",
+                    pcity->id, (void *) pcity, city_name_get(pcity), old->id,
+                    (void *) old, city_name_get(old));
   iworld->cities->insert(pcity->id, pcity);
 }
 
@@ -75,15 +64,12 @@ void idex_register_city(struct world *iworld, struct city *pcity)
  */
 void idex_register_unit(struct world *iworld, struct unit *punit)
 {
-  const struct unit *old;
-
-  if (iworld->units->contains(punit->id)) {
-    old = iworld->units->value(punit->id);
-    fc_assert_ret_msg(nullptr == old,
-                      "IDEX: unit collision: new %d %p %s, old %d %p %s",
-                      punit->id, (void *) punit, unit_rule_name(punit),
-                      old->id, (void *) old, unit_rule_name(old));
-  }
+  const struct unit *old = iworld->units->lookup(punit->id);
+
+  fc_assert_ret_msg(nullptr == old,
+                    "IDEX: unit collision: new %d %p %s, old %d %p %s",
+                    punit->id, (void *) punit, unit_rule_name(punit),
+                    old->id, (void *) old, unit_rule_name(old));
   iworld->units->insert(punit->id, punit);
 }
 
@@ -93,18 +79,17 @@ void idex_register_unit(struct world *iworld, struct unit *punit)
  */
 void idex_unregister_city(struct world *iworld, struct city *pcity)
 {
-  const struct city *old;
-
-  if (!iworld->units->contains(pcity->id)) {
-    old = pcity;
-    fc_assert_ret_msg(nullptr != old, "IDEX: city unreg missing: %d %p %s",
-                      pcity->id, (void *) pcity, city_name_get(pcity));
-    fc_assert_ret_msg(old == pcity,
-                      "IDEX: city unreg mismatch: "
-                      "unreg %d %p %s, old %d %p %s",
-                      pcity->id, (void *) pcity, city_name_get(pcity),
-                      old->id, (void *) old, city_name_get(old));
+  const struct city *old = iworld->cities->lookup(pcity->id);
+
+  if (nullptr == old) {
+    // Never registered, nothing to do
+    return;
   }
+  fc_assert_ret_msg(old == pcity,
+                    "IDEX: city unreg mismatch: "
+                    "unreg %d %p %s, old %d %p %s",
+                    pcity->id, (void *) pcity, city_name_get(pcity), old->id,
+                    (void *) old, city_name_get(old));
   iworld->cities->remove(pcity->id);
 }
 
@@ -114,18 +99,17 @@ void idex_unregister_city(struct world *iworld, struct city *pcity)
  */
 void idex_unregister_unit(struct world *iworld, struct unit *punit)
 {
-  const struct unit *old;
-
-  if (!iworld->units->contains(punit->id)) {
-    old = punit;
-    fc_assert_ret_msg(nullptr != old, "IDEX: unit unreg missing: %d %p %s",
-                      punit->id, (void *) punit, unit_rule_name(punit));
-    fc_assert_ret_msg(old == punit,
-                      "IDEX: unit unreg mismatch: "
-                      "unreg %d %p %s, old %d %p %s",
-                      punit->id, (void *) punit, unit_rule_name(punit),
-                      old->id, (void *) old, unit_rule_name(old));
+  const struct unit *old = iworld->units->lookup(punit->id);
+
+  if (nullptr == old) {
+    // Never registered, nothing to do
+    return;
   }
+  fc_assert_ret_msg(old == punit,
+                    "IDEX: unit unreg mismatch: "
+                    "unreg %d %p %s, old %d %p %s",
+                    punit->id, (void *) punit, unit_rule_name(punit),
+                    old->id, (void *) old, unit_rule_name(old));
   iworld->units->remove(punit->id);
 }
 
@@ -135,11 +119,7 @@ void idex_unregister_unit(struct world *iworld, struct unit *punit)
  */
 struct city *idex_lookup_city(struct world *iworld, int id)
 {
-  const struct city *pcity;
-
-  pcity = iworld->cities->value(id);
-
-  return const_cast<struct city *>(pcity);
+  return const_cast<struct city *>(iworld->cities->lookup(id));
 }
 
 /**
@@ -148,9 +128,5 @@ struct city *idex_lookup_city(struct world *iworld, int id)
  */
 struct unit *idex_lookup_unit(struct world *iworld, int id)
 {
-  const struct unit *punit;
-
-  punit = iworld->units->value(id);
-
-  return const_cast<struct unit *>(punit);
+  return const_cast<struct unit *>(iworld->units->lookup(id));
 }
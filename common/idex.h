@@ -8,11 +8,83 @@
    id values to unit and city pointers.
 ***************************************************************************/
 
+// utility
+#include "log.h" // fc_assert
+
 // common
 #include "city.h" // struct city
 #include "fc_types.h"
 #include "unit.h" // struct unit
 
+// std
+#include <algorithm> // std::max
+#include <cstddef>   // std::size_t
+#include <vector>    // std::vector
+
+/**
+ * A table mapping ids to objects. Ids handed out by the server are small
+ * and dense, so the objects are stored in a plain array indexed by id:
+ * lookups are a bounds check and a load, and never allocate.
+ */
+template <typename T> class idex_table {
+public:
+  /**
+   * Returns the object with the given id, or nullptr.
+   */
+  const T *lookup(int id) const
+  {
+    return unsigned(id) < m_slots.size() ? m_slots[id] : nullptr;
+  }
+
+  /**
+   * Stores an object. Returns the object previously stored with the same
+   * id, if any, in which case it is replaced. Negative ids are rejected.
+   */
+  const T *insert(int id, const T *object)
+  {
+    fc_assert_ret_val(id >= 0, nullptr);
+    if (unsigned(id) >= m_slots.size()) {
+      // Grow geometrically, ids are mostly handed out in increasing order
+      m_slots.resize(std::max<std::size_t>(id + 1, 2 * m_slots.size()),
+                     nullptr);
+    }
+    auto old = m_slots[id];
+    m_slots[id] = object;
+    m_count += (old == nullptr) - (object == nullptr);
+    return old;
+  }
+
+  /**
+   * Removes the object with the given id. Returns the object that was
+   * stored, if any.
+   */
+  const T *remove(int id)
+  {
+    return unsigned(id) < m_slots.size() ? insert(id, nullptr) : nullptr;
+  }
+
+  /**
+   * Number of objects in the table.
+   */
+  int size() const { return m_count; }
+
+  /**
+   * Calls f(id, object) for every object in the table, in id order.
+   */
+  template <typename F> void for_each(F &&f) const
+  {
+    for (std::size_t id = 0; id < m_slots.size(); id++) {
+      if (m_slots[id] != nullptr) {
+        f(int(id), m_slots[id]);
+      }
+    }
+  }
+
+private:
+  std::vector<const T *> m_slots;
+  int m_count = 0;
+};
+
 void idex_init(struct world *iworld);
 void idex_free(struct world *iworld);
 
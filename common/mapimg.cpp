@@ -7,6 +7,7 @@
 // utility
 #include "bitvector.h"
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "shared.h"
 #include "support.h"
@@ -25,14 +26,14 @@
 // Qt
 #include <QByteArray>
 #include <QByteArrayAlgorithms> // qstrlen, qstrdup, qstrncpy
-#include <QColor>
 #include <QFileInfo>
 #include <QImage>
 #include <QImageWriter>
 #include <QLatin1String>
-#include <QPainter>
+#include <QRgb>
 #include <QString>
 #include <QStringLiteral>
+#include <QThreadPool>
 #include <Qt>                    // Qt::*
 #include <QtContainerFwd>        // QStringList = QList<QString>
 #include <QtLogging>             // qDebug, qWarning, qCricital, etc
@@ -43,7 +44,9 @@
 #include <cstddef> // size_t
 #include <cstdio>  // sscanf
 #include <cstring> // str*, mem*
-#include <utility> // std::as_const
+#include <memory>
+#include <utility> // std::as_const, std::pair
+#include <vector>
 
 // == image colors ==
 enum img_special {
@@ -296,7 +299,18 @@ struct img {
     int x;
     int y;
   } imgsize; // image size
-  const struct rgbcolor **map;
+  std::vector<QRgb> map; // resolved colors, 0 is transparent
+};
+
+/* Everything needed to write an image file. It is independent of the game
+ * state and of the map definition, so it can be written by another
+ * thread. */
+struct img_job {
+  QString filename;
+  int zoom;
+  int width, height; // size before zooming
+  std::vector<QRgb> map;
+  std::vector<std::pair<QString, QString>> texts; // image metadata
 };
 
 static struct img *img_new(struct mapdef *mapdef, int topo, int xsize,
@@ -313,6 +327,11 @@ static void img_plot_tile(struct img *pimg, const struct tile *ptile,
                           const bv_pixel pixel);
 static bool img_save(const struct img *pimg, const char *mapimgfile,
                      const char *path);
+static bool img_prepare(const struct img *pimg, const char *mapimgfile,
+                        const char *path, struct img_job *job);
+static bool img_write(const struct img_job *job);
+static void img_write_async(struct img *pimg, const char *mapimgfile,
+                            const char *path);
 static bool img_filename(const char *mapimgfile, const QByteArray &format,
                          char *filename, size_t filename_len);
 static void img_createmap(struct img *pimg);
@@ -346,6 +365,8 @@ static struct {
   mapimg_tile_player_func mapimg_tile_unit;
   mapimg_plrcolor_count_func mapimg_plrcolor_count;
   mapimg_plrcolor_get_func mapimg_plrcolor_get;
+
+  QThreadPool *writer; // writes images in the background
 } mapimg = {.init = false};
 
 /*
@@ -388,6 +409,10 @@ void mapimg_init(mapimg_tile_known_func mapimg_tile_known,
   fc_assert_ret(mapimg_plrcolor_get != nullptr);
   mapimg.mapimg_plrcolor_get = mapimg_plrcolor_get;
 
+  // One thread keeps the files in order; rendering is parallel anyway.
+  mapimg.writer = new QThreadPool;
+  mapimg.writer->setMaxThreadCount(1);
+
   mapimg.init = true;
 }
 
@@ -422,6 +447,11 @@ void mapimg_free()
   mapimg_reset();
   mapdef_list_destroy(mapimg.mapdef);
 
+  // Finish the images still being written.
+  mapimg.writer->waitForDone();
+  delete mapimg.writer;
+  mapimg.writer = nullptr;
+
   mapimg.init = false;
 }
 
@@ -1057,9 +1087,12 @@ bool mapimg_id2str(int id, char *str, size_t str_len)
    contains the map definition and <mapext> the selected image extension.
    If 'force' is FALSE, the image is only created if game.info.turn is a
    multiple of the map setting turns.
+   If 'background' is TRUE, the map is captured right away but the image is
+   rendered and written by another thread. Errors while writing are only
+   logged.
  */
 bool mapimg_create(struct mapdef *pmapdef, bool force, const char *savename,
-                   const char *path)
+                   const char *path, bool background)
 {
   struct img *pimg;
   char mapimgfile[MAX_LEN_PATH];
@@ -1110,7 +1143,9 @@ bool mapimg_create(struct mapdef *pmapdef, bool force, const char *savename,
 
     pimg = img_new(pmapdef, CURRENT_TOPOLOGY, wld.map.xsize, wld.map.ysize);
     img_createmap(pimg);
-    if (!img_save(pimg, mapimgfile, path)) {
+    if (background) {
+      img_write_async(pimg, mapimgfile, path);
+    } else if (!img_save(pimg, mapimgfile, path)) {
       ret = false;
     }
     img_destroy(pimg);
@@ -1135,7 +1170,9 @@ bool mapimg_create(struct mapdef *pmapdef, bool force, const char *savename,
       pimg =
           img_new(pmapdef, CURRENT_TOPOLOGY, wld.map.xsize, wld.map.ysize);
       img_createmap(pimg);
-      if (!img_save(pimg, mapimgfile, path)) {
+      if (background) {
+        img_write_async(pimg, mapimgfile, path);
+      } else if (!img_save(pimg, mapimgfile, path)) {
         ret = false;
       }
       img_destroy(pimg);
@@ -1637,9 +1674,7 @@ static struct img *img_new(struct mapdef *mapdef, int topo, int xsize,
   }
 
   // Here the map image is saved as an array of RGB color values.
-  pimg->map = new const rgbcolor *[pimg->imgsize.x * pimg->imgsize.y]();
-  // Initialise map.
-  memset(pimg->map, 0, pimg->imgsize.x * pimg->imgsize.y);
+  pimg->map.assign(pimg->imgsize.x * pimg->imgsize.y, 0);
 
   return pimg;
 }
@@ -1651,7 +1686,6 @@ static void img_destroy(struct img *pimg)
 {
   if (pimg != nullptr) {
     // do not free pimg->def
-    delete[] pimg->map;
     delete pimg;
     pimg = nullptr;
   }
@@ -1663,13 +1697,14 @@ static void img_destroy(struct img *pimg)
 static inline void img_set_pixel(struct img *pimg, const int mindex,
                                  const struct rgbcolor *pcolor)
 {
-  if (mindex < 0 || mindex > pimg->imgsize.x * pimg->imgsize.y) {
+  if (mindex < 0 || mindex >= pimg->imgsize.x * pimg->imgsize.y) {
     qCritical("invalid index: 0 <= %d < %d", mindex,
               pimg->imgsize.x * pimg->imgsize.y);
     return;
   }
 
-  pimg->map[mindex] = pcolor;
+  pimg->map[mindex] =
+      pcolor ? qRgb(pcolor->r, pcolor->g, pcolor->b) : QRgb(0);
 }
 
 /**
@@ -1726,6 +1761,29 @@ static void img_plot_tile(struct img *pimg, const struct tile *ptile,
  */
 static bool img_save(const struct img *pimg, const char *mapimgfile,
                      const char *path)
+{
+  struct img_job job;
+
+  if (!img_prepare(pimg, mapimgfile, path, &job)) {
+    return false;
+  }
+  job.map = pimg->map;
+
+  if (!img_write(&job)) {
+    MAPIMG_LOG(_("could not write image '%s'"),
+               qUtf8Printable(job.filename));
+    return false;
+  }
+
+  return true;
+}
+
+/**
+   Collect everything needed to write the image. This uses the game state
+   and must be called from the main thread.
+ */
+static bool img_prepare(const struct img *pimg, const char *mapimgfile,
+                        const char *path, struct img_job *job)
 {
   char tmpname[600];
 
@@ -1750,16 +1808,14 @@ static bool img_save(const struct img *pimg, const char *mapimgfile,
     return false;
   }
 
-  QImage image(pimg->imgsize.x * pimg->def->zoom,
-               pimg->imgsize.y * pimg->def->zoom, QImage::Format_ARGB32);
-  if (image.isNull()) {
-    MAPIMG_LOG(_("could not allocate memory for image"));
-    return false;
-  }
+  job->filename = QString::fromUtf8(pngname);
+  job->zoom = pimg->def->zoom;
+  job->width = pimg->imgsize.x;
+  job->height = pimg->imgsize.y;
 
   if (pimg->def->colortest) {
-    image.setText(QStringLiteral("Description"),
-                  QStringLiteral("color test"));
+    job->texts.emplace_back(QStringLiteral("Description"),
+                            QStringLiteral("color test"));
   } else if (BV_ISSET_ANY(pimg->def->player.checked_plrbv)) {
     players_iterate(pplayer)
     {
@@ -1770,42 +1826,95 @@ static bool img_save(const struct img *pimg, const char *mapimgfile,
 
       const auto pcolor = imgcolor_player(player_index(pplayer));
 
-      image.setText(
+      job->texts.emplace_back(
           QStringLiteral("Player %1 color").arg(player_number(pplayer)),
           QStringLiteral("(%1, %2, %3)")
               .arg(pcolor->r)
               .arg(pcolor->g)
               .arg(pcolor->b));
-      image.setText(
+      job->texts.emplace_back(
           QStringLiteral("Player %1 name").arg(player_number(pplayer)),
-          player_name(pplayer));
+          QString::fromUtf8(player_name(pplayer)));
     }
     players_iterate_end;
   }
 
-  image.setDevicePixelRatio(pimg->def->zoom);
-  image.fill(Qt::transparent);
-
-  QPainter p;
-  p.begin(&image);
+  return true;
+}
 
-  // Iterate over tiles
-  for (int y = 0; y < pimg->imgsize.y; y++) {
-    for (int x = 0; x < pimg->imgsize.x; x++) {
-      if (const auto pcolor = pimg->map[img_index(x, y, pimg)]; pcolor) {
-        p.fillRect(x, y, 1, 1, QColor(pcolor->r, pcolor->g, pcolor->b));
-      }
-    }
+/**
+   Render and write an image. This doesn't touch the game state and can be
+   called from any thread. Rows are rendered in parallel, writing straight
+   into the scan lines of the image.
+ */
+static bool img_write(const struct img_job *job)
+{
+  const int zoom = job->zoom;
+  QImage image(job->width * zoom, job->height * zoom,
+               QImage::Format_ARGB32);
+  if (image.isNull()) {
+    qCritical("Could not allocate memory for map image '%s'.",
+              qUtf8Printable(job->filename));
+    return false;
   }
 
-  p.end();
+  for (const auto &[key, value] : job->texts) {
+    image.setText(key, value);
+  }
+  image.setDevicePixelRatio(zoom);
+
+  // Taken once: bits() may detach, which isn't safe from several threads.
+  uchar *bits = image.bits();
+  const qsizetype stride = image.bytesPerLine();
+  fc_parallel_for(
+      0, job->height,
+      [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+          const QRgb *src = job->map.data() + y * job->width;
+          for (int dy = 0; dy < zoom; dy++) {
+            auto line =
+                reinterpret_cast<QRgb *>(bits + (y * zoom + dy) * stride);
+            for (int x = 0; x < job->width; x++) {
+              for (int dx = 0; dx < zoom; dx++) {
+                *line++ = src[x];
+              }
+            }
+          }
+        }
+      },
+      16);
 
-  image.save(pngname);
-  qDebug("Map image saved as '%s'.", pngname);
+  if (!image.save(job->filename)) {
+    return false;
+  }
+  qDebug("Map image saved as '%s'.", qUtf8Printable(job->filename));
 
   return true;
 }
 
+/**
+   Queue an image to be rendered and written by the background writer.
+ */
+static void img_write_async(struct img *pimg, const char *mapimgfile,
+                            const char *path)
+{
+  auto job = std::make_shared<img_job>();
+
+  if (!img_prepare(pimg, mapimgfile, path, job.get())) {
+    qCritical("%s", mapimg_error());
+    return;
+  }
+  // The image is destroyed right after this
+  job->map = std::move(pimg->map);
+
+  mapimg.writer->start([job] {
+    if (!img_write(job.get())) {
+      qCritical("Could not write map image '%s'.",
+                qUtf8Printable(job->filename));
+    }
+  });
+}
+
 /**
    Generate the final filename.
  */
@@ -139,42 +139,57 @@ int read_socket_data(QIODevice *sock, struct socket_packet_buffer *buffer)
 }
 
 /**
-   Write wrapper function -vasc
+   Hand the data in buf to the socket if there is more than limit bytes.
+   Returns the number of bytes handed over, or -1 if the connection was
+   closed.
  */
 static int write_socket_data(struct connection *pc,
                              struct socket_packet_buffer *buf, int limit)
 {
-  int start, nput, nblock;
-
-  if (!conn_is_valid(pc)) {
+  if (!conn_is_valid(pc)
+      || buf->ndata <= static_cast<unsigned long>(limit)) {
     return 0;
   }
 
-  for (start = 0; buf->ndata - start > limit;) {
-    if (!pc->sock->isOpen()) {
-      connection_close(pc, _("network exception"));
-      return -1;
-    }
+  if (!pc->sock->isOpen()) {
+    connection_close(pc, _("network exception"));
+    return -1;
+  }
 
-    nblock = MIN(buf->ndata - start, MAX_LEN_PACKET);
-    log_debug("trying to write %d limit=%d", nblock, limit);
-    if ((nput = pc->sock->write(
-             reinterpret_cast<const char *>(buf->data) + start, nblock))
-        == -1) {
-      connection_close(pc, pc->sock->errorString().toUtf8().data());
-      return -1;
-    }
-    start += nput;
+  /* Sockets keep their own chain of write buffers and fill the kernel
+   * buffer from it as it drains, so everything is handed over at once
+   * instead of packet-sized pieces. */
+  log_debug("trying to write %lu limit=%d", buf->ndata, limit);
+  const qint64 nput = pc->sock->write(
+      reinterpret_cast<const char *>(buf->data), buf->ndata);
+  if (nput == -1) {
+    connection_close(pc, pc->sock->errorString().toUtf8().data());
+    return -1;
   }
 
-  if (start > 0) {
-    buf->ndata -= start;
-    memmove(buf->data, buf->data + start, buf->ndata);
+  if (nput > 0) {
+    buf->ndata -= nput;
+    if (buf->ndata > 0) {
+      memmove(buf->data, buf->data + nput, buf->ndata);
+    }
     pc->last_write = timer_renew(pc->last_write, TIMER_USER, TIMER_ACTIVE);
     timer_start(pc->last_write);
   }
 
-  return 0;
+  return nput;
+}
+
+/**
+   Ask the socket to send what it holds without waiting for the event
+   loop.
+ */
+static void flush_socket(struct connection *pc)
+{
+  if (auto socket = qobject_cast<QLocalSocket *>(pc->sock)) {
+    socket->flush();
+  } else if (auto socket = qobject_cast<QTcpSocket *>(pc->sock)) {
+    socket->flush();
+  }
 }
 
 /**
@@ -190,31 +205,27 @@ void flush_connection_send_buffer_all(struct connection *pc)
     }
   }
   if (pc && pc->sock) {
-    if (auto socket = qobject_cast<QLocalSocket *>(pc->sock)) {
-      socket->flush();
-    } else if (auto socket = qobject_cast<QTcpSocket *>(pc->sock)) {
-      socket->flush();
-    }
+    flush_socket(pc);
   }
 }
 
 /**
-   Flush'em
+   Flush'em, but only once a full packet worth of data is waiting. The
+   socket is only flushed when it got new data: trying again for every
+   packet queued to a client that doesn't read fast enough would cost a
+   system call each time.
  */
 static void flush_connection_send_buffer_packets(struct connection *pc)
 {
   if (pc && pc->used && pc->send_buffer->ndata >= MAX_LEN_PACKET) {
-    write_socket_data(pc, pc->send_buffer, MAX_LEN_PACKET - 1);
+    const int nput =
+        write_socket_data(pc, pc->send_buffer, MAX_LEN_PACKET - 1);
     if (pc->notify_of_writable_data) {
       pc->notify_of_writable_data(pc, pc->send_buffer
                                           && pc->send_buffer->ndata > 0);
     }
-  }
-  if (pc && pc->sock) {
-    if (auto socket = qobject_cast<QLocalSocket *>(pc->sock)) {
-      socket->flush();
-    } else if (auto socket = qobject_cast<QTcpSocket *>(pc->sock)) {
-      socket->flush();
+    if (nput > 0 && pc->sock) {
+      flush_socket(pc);
     }
   }
 }
@@ -595,15 +606,6 @@ void conn_list_compression_freeze(const struct conn_list *pconn_list)
   conn_list_iterate_end;
 }
 
-/**
-   Thaw a connection list.
- */
-void conn_list_compression_thaw(const struct conn_list *pconn_list)
-{
-  conn_list_iterate(pconn_list, pconn) { conn_compression_thaw(pconn); }
-  conn_list_iterate_end;
-}
-
 /**
    Returns TRUE if the given connection is attached to a player which it
    also controls (i.e. not a player observer).
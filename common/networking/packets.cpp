@@ -9,6 +9,7 @@
 
 // utility
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "shared.h"
 #include "support.h"
@@ -24,7 +25,6 @@
 #include <QByteArrayAlgorithms> // qstrlen, qstrdup, qstrncpy
 #include <QGlobalStatic>        // Q_GLOBAL_STATIC
 #include <QRegularExpression>
-#include <QScopedArrayPointer>
 #include <QString>
 #include <QtContainerFwd>        // QVector<QString>
 #include <QtLogging>             // qDebug, qWarning, qCricital, etc
@@ -33,6 +33,7 @@
 // std
 #include <cstdlib> // EXIT_FAILURE, free, at_quick_exit
 #include <cstring> // str*, mem*
+#include <vector>
 #include <zconf.h> // uLongf, Bytef
 #include <zlib.h>  // Z_*
 
@@ -85,22 +86,43 @@ static inline int get_compression_level()
   return level;
 }
 
+// The compression queue of a connection, compressed.
+struct compressed_queue {
+  std::vector<Bytef> data;
+  uLongf size = 0;
+  int level = 0;
+  int error = Z_OK;
+};
+
 /**
-   Send all waiting data. Return TRUE on success.
+   Compress the data waiting to be sent to the connection. This only reads
+   the queue and can be called from any thread.
  */
-static bool conn_compression_flush(struct connection *pconn)
+static void conn_compression_compress(const struct connection *pconn,
+                                      int compression_level,
+                                      struct compressed_queue *out)
+{
+  out->size = 12 + 1.001 * pconn->compression.queue.size;
+  out->data.resize(out->size);
+  out->level = compression_level;
+  out->error = compress2(out->data.data(), &out->size,
+                         pconn->compression.queue.p,
+                         pconn->compression.queue.size, compression_level);
+}
+
+/**
+   Send all waiting data, once compressed. Return TRUE on success.
+ */
+static bool conn_compression_send(struct connection *pconn,
+                                  const struct compressed_queue *queue)
 {
-  int compression_level = get_compression_level();
-  uLongf compressed_size = 12 + 1.001 * pconn->compression.queue.size;
-  int error;
-  QScopedArrayPointer<Bytef> compressed(new Bytef[compressed_size]);
+  const Bytef *compressed = queue->data.data();
+  const uLongf compressed_size = queue->size;
+  const int compression_level = queue->level;
   bool jumbo;
   unsigned long compressed_packet_len;
 
-  error = compress2(compressed.data(), &compressed_size,
-                    pconn->compression.queue.p,
-                    pconn->compression.queue.size, compression_level);
-  fc_assert_ret_val(error == Z_OK, false);
+  fc_assert_ret_val(queue->error == Z_OK, false);
 
   /* Compression signalling currently assumes a 2-byte packet length; if that
    * changes, the protocol should probably be changed */
@@ -127,8 +149,8 @@ static bool conn_compression_flush(struct connection *pconn)
       QByteArray dout;
       dio_put<std::uint16_t>(dout, 2 + compressed_size + COMPRESSION_BORDER);
       connection_send_data(pconn, dout);
-      connection_send_data(
-          pconn, QByteArrayView(compressed.data(), compressed_size));
+      connection_send_data(pconn,
+                           QByteArrayView(compressed, compressed_size));
     } else {
       FC_STATIC_ASSERT(JUMBO_SIZE >= JUMBO_BORDER + COMPRESSION_BORDER,
                        compressed_normal_jumbo_packet_len_overlap);
@@ -138,8 +160,8 @@ static bool conn_compression_flush(struct connection *pconn)
       dio_put<std::uint16_t>(dout, JUMBO_SIZE);
       dio_put<std::uint32_t>(dout, 6 + compressed_size);
       connection_send_data(pconn, dout);
-      connection_send_data(
-          pconn, QByteArrayView(compressed.data(), compressed_size));
+      connection_send_data(pconn,
+                           QByteArrayView(compressed, compressed_size));
     }
   } else {
     log_compress("COMPRESS: would enlarge %lu bytes to %ld; "
@@ -154,6 +176,17 @@ static bool conn_compression_flush(struct connection *pconn)
   return pconn->used;
 }
 
+/**
+   Send all waiting data. Return TRUE on success.
+ */
+static bool conn_compression_flush(struct connection *pconn)
+{
+  struct compressed_queue queue;
+
+  conn_compression_compress(pconn, get_compression_level(), &queue);
+  return conn_compression_send(pconn, &queue);
+}
+
 /**
    Thaw the connection. Then maybe compress the data waiting to send them
    to the connection. Returns TRUE on success. See also
@@ -172,6 +205,42 @@ bool conn_compression_thaw(struct connection *pconn)
   return pconn->used;
 }
 
+/**
+   Thaw a connection list. The queues of the connections that get thawed
+   are compressed in parallel, which helps when sending the same large
+   amount of data to many connections. They are then sent from this
+   thread, each in one piece, so the packet order is kept.
+ */
+void conn_list_compression_thaw(const struct conn_list *pconn_list)
+{
+  std::vector<struct connection *> thawed;
+
+  conn_list_iterate(pconn_list, pconn)
+  {
+    if (pconn->compression.frozen_level != 1) {
+      conn_compression_thaw(pconn);
+      continue;
+    }
+    pconn->compression.frozen_level = 0;
+    thawed.push_back(pconn);
+  }
+  conn_list_iterate_end;
+
+  // Read on this thread: it is initialized on first use.
+  const int compression_level = get_compression_level();
+  std::vector<struct compressed_queue> compressed(thawed.size());
+  fc_parallel_for(0, thawed.size(), [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      conn_compression_compress(thawed[i], compression_level,
+                                &compressed[i]);
+    }
+  });
+
+  for (std::size_t i = 0; i < thawed.size(); i++) {
+    conn_compression_send(thawed[i], &compressed[i]);
+  }
+}
+
 /**
    It returns the request id of the outgoing packet (or 0 if is_server()).
  */
@@ -762,6 +831,159 @@ void send_attribute_block(const struct player *pplayer,
   connection_do_unbuffer(pconn);
 }
 
+/**
+   Appends one plane of a tile snapshot to out: the value of a field for
+   every tile, as runs of up to 255 equal values.
+ */
+template <class T, class Get>
+static void snapshot_put_plane(QByteArray &out,
+                               const struct packet_tile_info *tiles,
+                               int count, Get get)
+{
+  for (int i = 0; i < count;) {
+    const int value = get(tiles[i]);
+    int run = 1;
+    while (i + run < count && run < UINT8_MAX
+           && get(tiles[i + run]) == value) {
+      run++;
+    }
+    dio_put(out, run, std::uint8_t{});
+    dio_put(out, value, T{});
+    i += run;
+  }
+}
+
+/**
+   Reads one plane written by snapshot_put_plane(). Returns false if the
+   data is malformed.
+ */
+template <class T, class Set>
+static bool snapshot_get_plane(QByteArrayView &in,
+                               std::vector<packet_tile_info> &tiles,
+                               Set set)
+{
+  for (std::size_t i = 0; i < tiles.size();) {
+    int run, value;
+    if (!dio_get(in, run, std::uint8_t{}) || !dio_get(in, value, T{})
+        || run == 0 || i + run > tiles.size()) {
+      return false;
+    }
+    for (int j = 0; j < run; j++) {
+      set(tiles[i++], value);
+    }
+  }
+  return true;
+}
+
+/**
+   Encodes the tile info of count consecutive tiles, starting at tiles[0],
+   in a tile snapshot packet. Labels and sprites are not encoded. Returns
+   false if the tiles don't fit in a single packet.
+
+   Every field is stored as a plane of run-length encoded values, so large
+   areas with the same terrain, owner or extras take a few bytes.
+ */
+bool tile_snapshot_encode(struct packet_tile_snapshot *packet,
+                          const struct packet_tile_info *tiles, int count)
+{
+  fc_assert_ret_val(count > 0 && count <= UINT16_MAX, false);
+
+  QByteArray out;
+  snapshot_put_plane<std::uint8_t>(out, tiles, count,
+                                   [](auto &t) { return t.known; });
+  snapshot_put_plane<std::int16_t>(out, tiles, count,
+                                   [](auto &t) { return t.continent; });
+  snapshot_put_plane<std::uint16_t>(out, tiles, count,
+                                    [](auto &t) { return t.owner; });
+  snapshot_put_plane<std::uint16_t>(out, tiles, count,
+                                    [](auto &t) { return t.extras_owner; });
+  snapshot_put_plane<std::uint16_t>(out, tiles, count,
+                                    [](auto &t) { return t.worked; });
+  snapshot_put_plane<std::uint8_t>(out, tiles, count,
+                                   [](auto &t) { return t.terrain; });
+  snapshot_put_plane<std::uint8_t>(out, tiles, count,
+                                   [](auto &t) { return t.resource; });
+  snapshot_put_plane<std::int8_t>(out, tiles, count,
+                                  [](auto &t) { return t.placing; });
+  snapshot_put_plane<std::int16_t>(out, tiles, count,
+                                   [](auto &t) { return t.place_turn; });
+
+  // Extras don't fit in an int
+  for (int i = 0; i < count;) {
+    int run = 1;
+    while (i + run < count && run < UINT8_MAX
+           && BV_ARE_EQUAL(tiles[i].extras, tiles[i + run].extras)) {
+      run++;
+    }
+    dio_put(out, run, std::uint8_t{});
+    dio_put(out, tiles[i].extras);
+    i += run;
+  }
+
+  if (out.size() > TILE_SNAPSHOT_SIZE) {
+    return false;
+  }
+
+  packet->first = tiles[0].tile;
+  packet->count = count;
+  packet->length = out.size();
+  memcpy(packet->data, out.constData(), out.size());
+  return true;
+}
+
+/**
+   Decodes a tile snapshot packet into tile info packets, with empty labels
+   and sprites. Returns false if the packet is malformed.
+ */
+bool tile_snapshot_decode(const struct packet_tile_snapshot *packet,
+                          std::vector<packet_tile_info> &tiles)
+{
+  if (packet->length < 0 || packet->length > TILE_SNAPSHOT_SIZE) {
+    return false;
+  }
+
+  tiles.assign(packet->count, packet_tile_info());
+  for (int i = 0; i < packet->count; i++) {
+    tiles[i].tile = packet->first + i;
+  }
+
+  QByteArrayView in(packet->data, packet->length);
+  if (!snapshot_get_plane<std::uint8_t>(
+          in, tiles, [](auto &t, int v) { t.known = known_type(v); })
+      || !snapshot_get_plane<std::int16_t>(
+          in, tiles, [](auto &t, int v) { t.continent = v; })
+      || !snapshot_get_plane<std::uint16_t>(
+          in, tiles, [](auto &t, int v) { t.owner = v; })
+      || !snapshot_get_plane<std::uint16_t>(
+          in, tiles, [](auto &t, int v) { t.extras_owner = v; })
+      || !snapshot_get_plane<std::uint16_t>(
+          in, tiles, [](auto &t, int v) { t.worked = v; })
+      || !snapshot_get_plane<std::uint8_t>(
+          in, tiles, [](auto &t, int v) { t.terrain = v; })
+      || !snapshot_get_plane<std::uint8_t>(
+          in, tiles, [](auto &t, int v) { t.resource = v; })
+      || !snapshot_get_plane<std::int8_t>(
+          in, tiles, [](auto &t, int v) { t.placing = v; })
+      || !snapshot_get_plane<std::int16_t>(
+          in, tiles, [](auto &t, int v) { t.place_turn = v; })) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < tiles.size();) {
+    int run;
+    bv_extras extras;
+    if (!dio_get(in, run, std::uint8_t{}) || !dio_get(in, extras)
+        || run == 0 || i + run > tiles.size()) {
+      return false;
+    }
+    for (int j = 0; j < run; j++) {
+      tiles[i++].extras = extras;
+    }
+  }
+
+  return in.isEmpty();
+}
+
 /**
    Destroy the packet handler hash table.
  */
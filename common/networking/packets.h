@@ -20,6 +20,7 @@ struct connection;
 // std
 #include <array>
 #include <memory>
+#include <vector>
 
 // Qt
 #include <QBitArray>
@@ -58,6 +59,10 @@ void send_attribute_block(const struct player *pplayer,
 void generic_handle_player_attribute_chunk(
     struct player *pplayer,
     const struct packet_player_attribute_chunk *chunk);
+bool tile_snapshot_encode(struct packet_tile_snapshot *packet,
+                          const struct packet_tile_info *tiles, int count);
+bool tile_snapshot_decode(const struct packet_tile_snapshot *packet,
+                          std::vector<packet_tile_info> &tiles);
 void packet_handlers_fill_initial(packet_handlers &handlers,
                                   packet_capabilities_type capability);
 void packet_handlers_fill_capability(packet_handlers &handlers,
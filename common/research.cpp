@@ -32,6 +32,7 @@
 #include <QtContainerFwd> // QVector<QString>
 
 // std
+#include <bitset>  // std::bitset
 #include <cstddef> // size_t
 #include <vector>  // std:vector
 
@@ -486,6 +487,57 @@ static bool research_get_root_reqs_known(const struct research *presearch,
   return true;
 }
 
+/**
+   Returns the set of 'tech' and all the techs it requires, directly or
+   not, as iterated by advance_req_iterate(). The sets of the requirements
+   are computed first and stored in 'closures'; 'done' marks the techs
+   whose set is stored.
+
+   Helper for research_update().
+ */
+static const bv_techs &research_req_closure(std::vector<bv_techs> &closures,
+                                            std::vector<bool> &done,
+                                            Tech_type_id tech)
+{
+  if (!done[tech]) {
+    // Set first: some techs are their own root requirement
+    done[tech] = true;
+    BV_CLR_ALL(closures[tech]);
+    BV_SET(closures[tech], tech);
+
+    const struct advance *padvance = valid_advance_by_number(tech);
+    if (nullptr != padvance) {
+      for (int req = AR_ONE; req < AR_SIZE; req++) {
+        const struct advance *preq =
+            valid_advance(advance_requires(padvance, tech_req(req)));
+
+        if (nullptr != preq && A_NONE != advance_number(preq)
+            && tech != advance_number(preq)) {
+          const bv_techs &reqs =
+              research_req_closure(closures, done, advance_number(preq));
+          BV_SET_ALL_FROM(closures[tech], reqs);
+        }
+      }
+    }
+  }
+
+  return closures[tech];
+}
+
+/**
+   Returns the number of techs in the set.
+ */
+static int research_techs_count(const bv_techs &techs)
+{
+  int count = 0;
+
+  for (auto byte : techs.vec) {
+    count += std::bitset<8>(byte).count();
+  }
+
+  return count;
+}
+
 /**
    Mark as TECH_PREREQS_KNOWN each tech which is available, not known and
    which has all requirements fullfiled.
@@ -496,6 +548,25 @@ static bool research_get_root_reqs_known(const struct research *presearch,
 void research_update(struct research *presearch)
 {
   int techs_researched;
+  /* The requirements of every tech, computed once instead of walking the
+   * tech tree again for each of them. */
+  std::vector<bv_techs> closures(A_LAST);
+  std::vector<bool> closure_done(A_LAST, false);
+  bv_techs known;
+  /* Unless research gets more expensive with each tech, the cost of a tech
+   * doesn't depend on the goal: compute it once. */
+  const bool cost_depends_on_order =
+      (game.info.tech_cost_style == TECH_COST_CIV1CIV2);
+  std::vector<int> bulbs(A_LAST, -1);
+
+  BV_CLR_ALL(known);
+  advance_index_iterate(A_FIRST, i)
+  {
+    if (TECH_KNOWN == research_invention_state(presearch, i)) {
+      BV_SET(known, i);
+    }
+  }
+  advance_index_iterate_end;
 
   advance_index_iterate(A_FIRST, i)
   {
@@ -538,6 +609,26 @@ void research_update(struct research *presearch)
       continue;
     }
 
+    const bv_techs &reqs = research_req_closure(closures, closure_done, i);
+    BV_SET_ALL_FROM(presearch->inventions[i].required_techs, reqs);
+    BV_CLR_ALL_FROM(presearch->inventions[i].required_techs, known);
+    presearch->inventions[i].num_required_techs =
+        research_techs_count(presearch->inventions[i].required_techs);
+
+    if (!cost_depends_on_order) {
+      advance_index_iterate(A_FIRST, j)
+      {
+        if (BV_ISSET(presearch->inventions[i].required_techs, j)) {
+          if (bulbs[j] < 0) {
+            bulbs[j] = research_total_bulbs_required(presearch, j, false);
+          }
+          presearch->inventions[i].bulbs_required += bulbs[j];
+        }
+      }
+      advance_index_iterate_end;
+      continue;
+    }
+
     techs_researched = presearch->techs_researched;
     advance_req_iterate(valid_advance_by_number(i), preq)
     {
@@ -547,8 +638,6 @@ void research_update(struct research *presearch)
         continue;
       }
 
-      BV_SET(presearch->inventions[i].required_techs, j);
-      presearch->inventions[i].num_required_techs++;
       presearch->inventions[i].bulbs_required +=
           research_total_bulbs_required(presearch, j, false);
       /* This is needed to get a correct result for the
@@ -37,11 +37,15 @@ extern "C" {
 #include "api_common_intl.h"
 #include "api_common_utilities.h"
 #include "luascript_func.h"
+#include "luascript_profile.h"
 #include "luascript_signal.h"
 #include "tolua_common_a_gen.h"
 
 #include "luascript.h"
 
+// Qt
+#include <QElapsedTimer>
+
 /**
   Configuration for script execution time limits. Checkinterval is the
   number of executed lua instructions between checking. Disabled if 0.
@@ -49,6 +53,12 @@ extern "C" {
 #define LUASCRIPT_MAX_EXECUTION_TIME_SEC 5.0
 #define LUASCRIPT_CHECKINTERVAL 10000
 
+/**
+  Number of executed lua instructions between checks when the profiler is
+  running. Instruction counts are sampled with this granularity.
+ */
+#define LUASCRIPT_PROFILE_INTERVAL 100
+
 // The name used for the freeciv lua struct saved in the lua state.
 #define LUASCRIPT_GLOBAL_VAR_NAME "__fcl"
 
@@ -106,8 +116,8 @@ static int luascript_report(struct fc_lua *fcl, int status,
 static void luascript_traceback_func_save(lua_State *L);
 static void luascript_traceback_func_push(lua_State *L);
 static void luascript_exec_check(lua_State *L, lua_Debug *ar);
-static void luascript_hook_start(lua_State *L);
-static void luascript_hook_end(lua_State *L);
+static void luascript_hook_start(struct fc_lua *fcl);
+static void luascript_hook_end(struct fc_lua *fcl);
 static void luascript_openlibs(lua_State *L, const luaL_Reg *llib);
 static void luascript_blacklist(lua_State *L, const char *lsymbols[]);
 
@@ -160,12 +170,24 @@ static void luascript_traceback_func_push(lua_State *L)
 }
 
 /**
-   Check currently excecuting lua function for execution time limit
+   Check currently excecuting lua function for execution time limit. Also
+   feeds the profiler when it is running.
  */
 static void luascript_exec_check(lua_State *L, lua_Debug *ar)
 {
-  Q_UNUSED(ar)
   lua_Number exec_clock;
+  struct fc_lua *fcl;
+
+  lua_getfield(L, LUA_REGISTRYINDEX, LUASCRIPT_GLOBAL_VAR_NAME);
+  fcl = static_cast<fc_lua *>(lua_touserdata(L, -1));
+  lua_pop(L, 1);
+
+  if (ar->event != LUA_HOOKCOUNT) {
+    // Only requested by the profiler
+    luascript_profile_event(fcl, L, ar);
+    return;
+  }
+  luascript_profile_count(fcl, LUASCRIPT_PROFILE_INTERVAL);
 
   lua_getfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
   exec_clock = lua_tonumber(L, -1);
@@ -177,26 +199,41 @@ static void luascript_exec_check(lua_State *L, lua_Debug *ar)
 }
 
 /**
-   Setup function execution guard
+   Setup function execution guard. Only the outermost call is guarded, so
+   that scripts can't escape the time limit by calling back into Lua.
  */
-static void luascript_hook_start(lua_State *L)
+static void luascript_hook_start(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
+  if (fcl->hook_depth++ > 0) {
+    return;
+  }
+
   // Store clock timestamp in the registry
-  lua_pushnumber(L, clock());
-  lua_setfield(L, LUA_REGISTRYINDEX, "freeciv_exec_clock");
-  lua_sethook(L, luascript_exec_check, LUA_MASKCOUNT,
-              LUASCRIPT_CHECKINTERVAL);
+  lua_pushnumber(fcl->state, clock());
+  lua_setfield(fcl->state, LUA_REGISTRYINDEX, "freeciv_exec_clock");
+  if (luascript_profile_running(fcl)) {
+    lua_sethook(fcl->state, luascript_exec_check,
+                LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT,
+                LUASCRIPT_PROFILE_INTERVAL);
+  } else {
+    lua_sethook(fcl->state, luascript_exec_check, LUA_MASKCOUNT,
+                LUASCRIPT_CHECKINTERVAL);
+  }
 #endif
 }
 
 /**
    Clear function execution guard
  */
-static void luascript_hook_end(lua_State *L)
+static void luascript_hook_end(struct fc_lua *fcl)
 {
 #if LUASCRIPT_CHECKINTERVAL
-  lua_sethook(L, luascript_exec_check, 0, 0);
+  if (--fcl->hook_depth > 0) {
+    return;
+  }
+
+  lua_sethook(fcl->state, luascript_exec_check, 0, 0);
 #endif
 }
 
@@ -342,6 +379,8 @@ void luascript_destroy(struct fc_lua *fcl)
     // Free signal data.
     luascript_signal_free(fcl);
 
+    luascript_profile_free(fcl);
+
     // Free lua state.
     if (fcl->state) {
       lua_gc(fcl->state, LUA_GCCOLLECT, 0); // Collected garbage
@@ -581,6 +620,7 @@ int luascript_call(struct fc_lua *fcl, int narg, int nret, const char *code)
   int status;
   int base;          // Index of function to call
   int traceback = 0; // Index of traceback function
+  int depth;         // Depth of the profiler stack
 
   fc_assert_ret_val(fcl, 0);
   fc_assert_ret_val(fcl->state, 0);
@@ -596,9 +636,12 @@ int luascript_call(struct fc_lua *fcl, int narg, int nret, const char *code)
     lua_pop(fcl->state, 1); // pop non-function traceback
   }
 
-  luascript_hook_start(fcl->state);
+  depth = luascript_profile_depth(fcl);
+  luascript_hook_start(fcl);
   status = lua_pcall(fcl->state, narg, nret, traceback);
-  luascript_hook_end(fcl->state);
+  luascript_hook_end(fcl);
+  // Frames left behind by errors
+  luascript_profile_unwind(fcl, depth);
 
   if (status) {
     luascript_report(fcl, status, code);
@@ -658,6 +701,8 @@ bool luascript_callback_invoke(struct fc_lua *fcl, const char *callback_name,
                                va_list args)
 {
   bool stop_emission = false;
+  QElapsedTimer timer;
+  int depth;
 
   fc_assert_ret_val(fcl, false);
   fc_assert_ret_val(fcl->state, false);
@@ -674,18 +719,31 @@ bool luascript_callback_invoke(struct fc_lua *fcl, const char *callback_name,
 
   luascript_log(fcl, LOG_DEBUG, "lua callback: '%s'", callback_name);
 
+  if (fcl->callback_budget_ms > 0) {
+    timer.start();
+  }
+  depth = luascript_profile_depth(fcl);
+  luascript_profile_enter(
+      fcl, qUtf8Printable(QStringLiteral("callback:") + callback_name));
+
   luascript_push_args(fcl, nargs, parg_types, args);
 
   // Call the function with nargs arguments, return 1 results
-  if (luascript_call(fcl, nargs, 1, nullptr)) {
-    return false;
+  if (luascript_call(fcl, nargs, 1, nullptr) == 0) {
+    // Shall we stop the emission of this signal?
+    if (lua_isboolean(fcl->state, -1)) {
+      stop_emission = lua_toboolean(fcl->state, -1);
+    }
+    lua_pop(fcl->state, 1); // pop return value
   }
 
-  // Shall we stop the emission of this signal?
-  if (lua_isboolean(fcl->state, -1)) {
-    stop_emission = lua_toboolean(fcl->state, -1);
+  luascript_profile_unwind(fcl, depth);
+  if (timer.isValid() && timer.elapsed() > fcl->callback_budget_ms) {
+    luascript_log(fcl, LOG_WARN,
+                  "lua callback '%s' took %lld ms, more than the budget "
+                  "of %d ms",
+                  callback_name, timer.elapsed(), fcl->callback_budget_ms);
   }
-  lua_pop(fcl->state, 1); // pop return value
 
   return stop_emission;
 }
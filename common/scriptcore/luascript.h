@@ -29,6 +29,7 @@ struct luascript_signal_hash;
 struct luascript_signal_name_list;
 struct connection;
 struct fc_lua;
+struct luascript_profiler;
 
 typedef void (*luascript_log_func_t)(struct fc_lua *fcl, QtMsgType level,
                                      const char *format, ...)
@@ -45,6 +46,11 @@ struct fc_lua {
 
   QHash<QString, struct signal *> *signals_hash;
   QVector<QString> *signal_names;
+  QVector<struct signal *> *signal_list; // indexed by signal id
+
+  int hook_depth; // number of nested luascript_call()
+  struct luascript_profiler *profiler;
+  int callback_budget_ms; // warn about slower callbacks, 0 to disable
 };
 
 // Error functions for lua scripts.
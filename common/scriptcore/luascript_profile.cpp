@@ -0,0 +1,295 @@
+/*
+ Copyright (c) 1996-2020 Freeciv21 and Freeciv contributors. This file is
+ part of Freeciv21. Freeciv21 is free software: you can redistribute it
+ and/or modify it under the terms of the GNU  General Public License  as
+ published by the Free Software Foundation, either version 3 of the
+ License,  or (at your option) any later version. You should have received
+ a copy of the GNU General Public License along with Freeciv21. If not,
+ see https://www.gnu.org/licenses/.
+ */
+
+/**
+  Lua profiler.
+
+  When running, the Lua hooks installed by luascript_call() also report
+  function calls and returns. Every call pushes a frame on a shadow stack;
+  when the frame is popped its duration is attributed to the function and
+  to the current stack, in the "folded" format understood by flamegraph
+  tools:
+
+    callback:unit_moved_cb;function <script.lua:12>;find_city [C] 1234
+
+  Signal callbacks are pushed as extra frames so that the stacks start
+  with the callback name. Instructions are counted by sampling: every
+  count hook adds the hook interval to the function on top of the stack.
+
+  Errors unwind the Lua stack without return events, so the callers
+  record the depth of the shadow stack and unwind to it afterwards.
+ */
+
+/* dependencies/lua */
+extern "C" {
+#include "lua.h"
+}
+
+// utility
+#include "log.h"
+
+/* common/scriptcore */
+#include "luascript.h"
+
+#include "luascript_profile.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+
+// std
+#include <algorithm>
+#include <vector>
+
+struct luascript_profiler {
+  struct frame {
+    int function;     // index in functions
+    qint64 start;     // when the frame was entered
+    qint64 children;  // time spent in called functions
+    int path_length;  // length of path without this frame
+    bool synthetic;   // not a Lua function (callback marker)
+  };
+
+  bool running = false;
+  QElapsedTimer clock;
+  std::vector<frame> stack;
+  QByteArray path; // frames of the stack, separated by ';'
+
+  QHash<QByteArray, int> function_index;
+  QVector<luascript_profile_entry> functions;
+  QHash<QByteArray, qint64> folded; // self time per stack
+};
+
+/**
+   Push a frame for the function called name.
+ */
+static void profile_push(struct luascript_profiler *prof, QByteArray name,
+                         bool synthetic)
+{
+  // ';' separates frames in the folded format
+  name.replace(';', ':');
+
+  auto it = prof->function_index.constFind(name);
+  int index;
+  if (it != prof->function_index.constEnd()) {
+    index = *it;
+  } else {
+    index = prof->functions.size();
+    prof->function_index.insert(name, index);
+    prof->functions.append({QString::fromUtf8(name), 0, 0, 0, 0});
+  }
+  prof->functions[index].calls++;
+
+  prof->stack.push_back({index, prof->clock.nsecsElapsed(), 0,
+                         int(prof->path.size()), synthetic});
+  if (!prof->path.isEmpty()) {
+    prof->path += ';';
+  }
+  prof->path += name;
+}
+
+/**
+   Pop the frame on top of the stack and account for its time. Recursive
+   functions have their total time counted once per active call.
+ */
+static void profile_pop(struct luascript_profiler *prof)
+{
+  const auto top = prof->stack.back();
+  const qint64 elapsed = prof->clock.nsecsElapsed() - top.start;
+  const qint64 self = elapsed - top.children;
+  auto &entry = prof->functions[top.function];
+
+  entry.total_nsecs += elapsed;
+  entry.self_nsecs += self;
+  prof->folded[prof->path] += self;
+
+  prof->path.truncate(top.path_length);
+  prof->stack.pop_back();
+  if (!prof->stack.empty()) {
+    prof->stack.back().children += elapsed;
+  }
+}
+
+/**
+   Start profiling, discarding the results of any previous run.
+ */
+void luascript_profile_start(struct fc_lua *fcl)
+{
+  fc_assert_ret(fcl);
+
+  delete fcl->profiler;
+  fcl->profiler = new luascript_profiler;
+  fcl->profiler->running = true;
+  fcl->profiler->clock.start();
+}
+
+/**
+   Stop profiling. The results are kept until the next start.
+ */
+void luascript_profile_stop(struct fc_lua *fcl)
+{
+  fc_assert_ret(fcl);
+
+  if (fcl->profiler != nullptr) {
+    luascript_profile_unwind(fcl, 0);
+    fcl->profiler->running = false;
+  }
+}
+
+/**
+   Returns whether the profiler is running.
+ */
+bool luascript_profile_running(const struct fc_lua *fcl)
+{
+  return fcl != nullptr && fcl->profiler != nullptr
+         && fcl->profiler->running;
+}
+
+/**
+   Returns the profile of every function called so far, by decreasing self
+   time.
+ */
+QVector<luascript_profile_entry>
+luascript_profile_entries(const struct fc_lua *fcl)
+{
+  if (fcl == nullptr || fcl->profiler == nullptr) {
+    return {};
+  }
+
+  auto entries = fcl->profiler->functions;
+  std::sort(entries.begin(), entries.end(),
+            [](const auto &lhs, const auto &rhs) {
+              return lhs.self_nsecs > rhs.self_nsecs;
+            });
+  return entries;
+}
+
+/**
+   Write the folded stacks to filename, with the time in microseconds.
+   Returns false if the file could not be written.
+ */
+bool luascript_profile_dump(const struct fc_lua *fcl,
+                            const QString &filename)
+{
+  fc_assert_ret_val(fcl, false);
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+
+  if (fcl->profiler != nullptr) {
+    for (auto it = fcl->profiler->folded.constBegin();
+         it != fcl->profiler->folded.constEnd(); ++it) {
+      const auto usecs = it.value() / 1000;
+      if (usecs > 0) {
+        file.write(it.key() + ' ' + QByteArray::number(usecs) + '\n');
+      }
+    }
+  }
+
+  return file.error() == QFileDevice::NoError;
+}
+
+/**
+   Free the profiler data.
+ */
+void luascript_profile_free(struct fc_lua *fcl)
+{
+  if (fcl != nullptr) {
+    delete fcl->profiler;
+    fcl->profiler = nullptr;
+  }
+}
+
+/**
+   Handle a call or return hook event.
+ */
+void luascript_profile_event(struct fc_lua *fcl, lua_State *L,
+                             lua_Debug *ar)
+{
+  if (!luascript_profile_running(fcl)) {
+    return;
+  }
+  auto prof = fcl->profiler;
+
+  switch (ar->event) {
+  case LUA_HOOKTAILCALL:
+    // The calling function is replaced
+    if (!prof->stack.empty() && !prof->stack.back().synthetic) {
+      profile_pop(prof);
+    }
+    // Fall through
+  case LUA_HOOKCALL: {
+    lua_getinfo(L, "nS", ar);
+    QByteArray name;
+    if (ar->what[0] == 'C') {
+      name = QByteArray(ar->name ? ar->name : "?") + " [C]";
+    } else if (ar->name != nullptr) {
+      name = QByteArray(ar->name) + " <" + ar->short_src + ":"
+             + QByteArray::number(ar->linedefined) + ">";
+    } else {
+      name = QByteArray("function <") + ar->short_src + ":"
+             + QByteArray::number(ar->linedefined) + ">";
+    }
+    profile_push(prof, name, false);
+  } break;
+  case LUA_HOOKRET:
+    if (!prof->stack.empty() && !prof->stack.back().synthetic) {
+      profile_pop(prof);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+   Attribute instructions to the function being run.
+ */
+void luascript_profile_count(struct fc_lua *fcl, int instructions)
+{
+  if (luascript_profile_running(fcl) && !fcl->profiler->stack.empty()) {
+    auto &top = fcl->profiler->stack.back();
+    fcl->profiler->functions[top.function].instructions += instructions;
+  }
+}
+
+/**
+   Returns the depth of the profiler stack, for luascript_profile_unwind().
+ */
+int luascript_profile_depth(const struct fc_lua *fcl)
+{
+  return luascript_profile_running(fcl) ? int(fcl->profiler->stack.size())
+                                        : 0;
+}
+
+/**
+   Push a frame that isn't a Lua function, such as the name of a callback.
+ */
+void luascript_profile_enter(struct fc_lua *fcl, const char *name)
+{
+  if (luascript_profile_running(fcl)) {
+    profile_push(fcl->profiler, name, true);
+  }
+}
+
+/**
+   Pop frames until the stack has the given depth.
+ */
+void luascript_profile_unwind(struct fc_lua *fcl, int depth)
+{
+  if (luascript_profile_running(fcl)) {
+    while (int(fcl->profiler->stack.size()) > depth) {
+      profile_pop(fcl->profiler);
+    }
+  }
+}
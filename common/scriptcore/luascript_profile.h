@@ -0,0 +1,44 @@
+/**************************************************************************
+ Copyright (c) 1996-2020 Freeciv21 and Freeciv contributors. This file is
+ part of Freeciv21. Freeciv21 is free software: you can redistribute it
+ and/or modify it under the terms of the GNU  General Public License  as
+ published by the Free Software Foundation, either version 3 of the
+ License,  or (at your option) any later version. You should have received
+ a copy of the GNU General Public License along with Freeciv21. If not,
+ see https://www.gnu.org/licenses/.
+**************************************************************************/
+#pragma once
+
+// Qt
+#include <QString>
+#include <QVector>
+
+struct fc_lua;
+struct lua_Debug;
+struct lua_State;
+
+// Time and instructions spent in a Lua function.
+struct luascript_profile_entry {
+  QString name;
+  unsigned long calls;
+  qint64 total_nsecs;  // including called functions
+  qint64 self_nsecs;   // excluding called functions
+  qint64 instructions; // approximate, excluding called functions
+};
+
+void luascript_profile_start(struct fc_lua *fcl);
+void luascript_profile_stop(struct fc_lua *fcl);
+bool luascript_profile_running(const struct fc_lua *fcl);
+QVector<luascript_profile_entry>
+luascript_profile_entries(const struct fc_lua *fcl);
+bool luascript_profile_dump(const struct fc_lua *fcl,
+                            const QString &filename);
+void luascript_profile_free(struct fc_lua *fcl);
+
+// Used by the hooks in luascript.cpp
+void luascript_profile_event(struct fc_lua *fcl, lua_State *L,
+                             lua_Debug *ar);
+void luascript_profile_count(struct fc_lua *fcl, int instructions);
+int luascript_profile_depth(const struct fc_lua *fcl);
+void luascript_profile_enter(struct fc_lua *fcl, const char *name);
+void luascript_profile_unwind(struct fc_lua *fcl, int depth);
@@ -42,6 +42,9 @@
 
 #include "luascript_signal.h"
 
+// Qt
+#include <QElapsedTimer>
+
 static struct signal_callback *signal_callback_new(const char *name);
 static void signal_callback_destroy(struct signal_callback *pcallback);
 static struct signal *signal_new(int nargs, enum api_types *parg_types);
@@ -78,6 +81,8 @@ static struct signal *signal_new(int nargs, enum api_types *parg_types)
   psignal->arg_types = parg_types;
   psignal->callbacks = new QList<signal_callback *>;
   psignal->depr_msg = nullptr;
+  psignal->emissions = 0;
+  psignal->lua_nsecs = 0;
 
   return psignal;
 }
@@ -97,6 +102,34 @@ static void signal_destroy(struct signal *psignal)
   delete psignal;
 }
 
+/**
+   Invoke all the callback functions attached to a signal.
+ */
+static void signal_emit(struct fc_lua *fcl, struct signal *psignal,
+                        va_list args)
+{
+  psignal->emissions++;
+  if (psignal->callbacks->isEmpty()) {
+    // Most signals have no callback, don't bother with Lua at all
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  for (auto *pcallback : std::as_const(*psignal->callbacks)) {
+    va_list args_cb;
+
+    va_copy(args_cb, args);
+    if (luascript_callback_invoke(fcl, pcallback->name, psignal->nargs,
+                                  psignal->arg_types, args_cb)) {
+      va_end(args_cb);
+      break;
+    }
+    va_end(args_cb);
+  }
+  psignal->lua_nsecs += timer.nsecsElapsed();
+}
+
 /**
    Invoke all the callback functions attached to a given signal.
  */
@@ -110,17 +143,7 @@ void luascript_signal_emit_valist(struct fc_lua *fcl,
 
   psignal = fcl->signals_hash->value(signal_name, nullptr);
   if (psignal) {
-    for (auto *pcallback : std::as_const(*psignal->callbacks)) {
-      va_list args_cb;
-
-      va_copy(args_cb, args);
-      if (luascript_callback_invoke(fcl, pcallback->name, psignal->nargs,
-                                    psignal->arg_types, args_cb)) {
-        va_end(args_cb);
-        break;
-      }
-      va_end(args_cb);
-    }
+    signal_emit(fcl, psignal, args);
   } else {
     luascript_log(fcl, LOG_ERROR,
                   "Signal \"%s\" does not exist, so cannot "
@@ -129,6 +152,34 @@ void luascript_signal_emit_valist(struct fc_lua *fcl,
   }
 }
 
+/**
+   Invoke all the callback functions attached to the signal with the given
+   id, as returned by luascript_signal_id(). This is cheaper than looking
+   the signal up by name.
+ */
+void luascript_signal_emit_id_valist(struct fc_lua *fcl, int signal_id,
+                                     va_list args)
+{
+  fc_assert_ret(fcl);
+  fc_assert_ret(fcl->signal_list);
+  fc_assert_ret(0 <= signal_id && signal_id < fcl->signal_list->size());
+
+  signal_emit(fcl, fcl->signal_list->at(signal_id), args);
+}
+
+/**
+   Returns the id of a signal, usable with luascript_signal_emit_id_valist(),
+   or -1 if the signal doesn't exist. Ids are given in the order the
+   signals are created.
+ */
+int luascript_signal_id(struct fc_lua *fcl, const char *signal_name)
+{
+  fc_assert_ret_val(fcl, -1);
+  fc_assert_ret_val(fcl->signal_names, -1);
+
+  return fcl->signal_names->indexOf(QString(signal_name));
+}
+
 /**
    Invoke all the callback functions attached to a given signal.
  */
@@ -170,6 +221,7 @@ static struct signal *luascript_signal_create_valist(struct fc_lua *fcl,
     created = signal_new(nargs, parg_types);
     fcl->signals_hash->insert(signal_name, created);
     fcl->signal_names->append(sn);
+    fcl->signal_list->append(created);
 
     return created;
   }
@@ -305,6 +357,7 @@ void luascript_signal_init(struct fc_lua *fcl)
   if (nullptr == fcl->signals_hash) {
     fcl->signals_hash = new QHash<QString, struct signal *>;
     fcl->signal_names = new QVector<QString>;
+    fcl->signal_list = new QVector<struct signal *>;
   }
 }
 
@@ -321,8 +374,10 @@ void luascript_signal_free(struct fc_lua *fcl)
   }
   delete fcl->signals_hash;
   delete fcl->signal_names;
+  delete fcl->signal_list;
   fcl->signals_hash = nullptr;
   fcl->signal_names = nullptr;
+  fcl->signal_list = nullptr;
 }
 
 /**
@@ -337,6 +392,20 @@ QString luascript_signal_by_index(struct fc_lua *fcl, int sindex)
                                             : QString();
 }
 
+/**
+   Return the signal with the given index, or nullptr.
+ */
+const struct signal *luascript_signal_data_by_index(struct fc_lua *fcl,
+                                                    int sindex)
+{
+  fc_assert_ret_val(fcl != nullptr, nullptr);
+  fc_assert_ret_val(fcl->signal_list != nullptr, nullptr);
+
+  return 0 <= sindex && sindex < fcl->signal_list->size()
+             ? fcl->signal_list->at(sindex)
+             : nullptr;
+}
+
 /**
    Return the name of the 'index' callback function of the signal with the
    name 'signal_name'.
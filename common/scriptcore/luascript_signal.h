@@ -27,6 +27,8 @@ struct signal {
   enum api_types *arg_types;           // argument types
   QList<signal_callback *> *callbacks; // connected callbacks
   char *depr_msg; // deprecation message to show if handler added
+  unsigned long emissions; // number of times the signal was emitted
+  qint64 lua_nsecs;        // time spent in the callbacks
 };
 
 void luascript_signal_init(struct fc_lua *fcl);
@@ -35,6 +37,9 @@ void luascript_signal_free(struct fc_lua *fcl);
 void luascript_signal_emit_valist(struct fc_lua *fcl,
                                   const char *signal_name, va_list args);
 void luascript_signal_emit(struct fc_lua *fcl, const char *signal_name, ...);
+int luascript_signal_id(struct fc_lua *fcl, const char *signal_name);
+void luascript_signal_emit_id_valist(struct fc_lua *fcl, int signal_id,
+                                     va_list args);
 signal_deprecator *luascript_signal_create(struct fc_lua *fcl,
                                            const char *signal_name,
                                            int nargs, ...);
@@ -47,6 +52,8 @@ bool luascript_signal_callback_defined(struct fc_lua *fcl,
                                        const char *callback_name);
 
 QString luascript_signal_by_index(struct fc_lua *fcl, int sindex);
+const struct signal *luascript_signal_data_by_index(struct fc_lua *fcl,
+                                                    int sindex);
 const char *luascript_signal_callback_by_index(struct fc_lua *fcl,
                                                const char *signal_name,
                                                int sindex);
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "timing.h"
+
+// common
+#include "connection.h"
+
+// Qt
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+
+// std
+#include <cstdlib> // free
+#include <memory>
+#include <vector>
+
+/**
+ * Sends data to many local clients through the connection send buffers.
+ * This opens real sockets and is not part of the test suite.
+ */
+class benchmark_connection : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void buffered_sends();
+  void benchmark_broadcast();
+
+private:
+  void send_round(int count);
+  bool receive_all(qint64 expected, bool check);
+
+  QTcpServer server;
+  std::vector<std::unique_ptr<QTcpSocket>> clients;
+  std::vector<connection> conns;
+};
+
+namespace {
+/// Number of fake clients.
+constexpr int CLIENTS = 128;
+/// Size of the fake packets.
+constexpr int PACKET_SIZE = 200;
+/// Packets sent to every client per round.
+constexpr int PACKETS = 500;
+
+/**
+ * Marks the connection as closing, as the server does
+ */
+void close_callback(struct connection *pconn) { pconn->is_closing = true; }
+
+/**
+ * A fake packet with recognizable contents
+ */
+QByteArray make_packet()
+{
+  QByteArray packet(PACKET_SIZE, '\0');
+  for (int i = 0; i < PACKET_SIZE; i++) {
+    packet[i] = char(i % 251);
+  }
+  return packet;
+}
+} // anonymous namespace
+
+/**
+ * Connects the fake clients
+ */
+void benchmark_connection::initTestCase()
+{
+  connections_set_close_callback(close_callback);
+  QVERIFY(server.listen(QHostAddress::LocalHost));
+
+  conns = std::vector<connection>(CLIENTS);
+  for (auto &pconn : conns) {
+    auto client = std::make_unique<QTcpSocket>();
+    client->connectToHost(QHostAddress::LocalHost, server.serverPort());
+    QVERIFY(server.waitForNewConnection(5000));
+    QVERIFY(client->waitForConnected(5000));
+    clients.push_back(std::move(client));
+
+    pconn.sock = server.nextPendingConnection();
+    QVERIFY(pconn.sock != nullptr);
+    pconn.used = true;
+    pconn.is_closing = false;
+    pconn.last_write = nullptr;
+    pconn.send_buffer = new_socket_packet_buffer();
+    pconn.statistics.bytes_send = 0;
+  }
+}
+
+/**
+ * Frees the connections
+ */
+void benchmark_connection::cleanupTestCase()
+{
+  for (auto &pconn : conns) {
+    free(pconn.send_buffer->data);
+    delete pconn.send_buffer;
+    timer_destroy(pconn.last_write);
+  }
+  clients.clear();
+}
+
+/**
+ * Sends count packets to every client, buffered as the server does
+ */
+void benchmark_connection::send_round(int count)
+{
+  const auto packet = make_packet();
+  for (auto &pconn : conns) {
+    connection_do_buffer(&pconn);
+  }
+  for (int i = 0; i < count; i++) {
+    for (auto &pconn : conns) {
+      connection_send_data(&pconn, packet);
+    }
+  }
+  for (auto &pconn : conns) {
+    connection_do_unbuffer(&pconn);
+  }
+}
+
+/**
+ * Runs the event loop until every client got expected bytes. With check,
+ * also verifies that the data is a sequence of fake packets.
+ */
+bool benchmark_connection::receive_all(qint64 expected, bool check)
+{
+  const auto packet = make_packet();
+  std::vector<QByteArray> received(CLIENTS);
+  std::vector<qint64> sizes(CLIENTS, 0);
+  QElapsedTimer timer;
+  timer.start();
+
+  int done = 0;
+  while (done < CLIENTS && timer.elapsed() < 30000) {
+    QCoreApplication::processEvents();
+    done = 0;
+    for (int i = 0; i < CLIENTS; i++) {
+      const auto data = clients[i]->readAll();
+      sizes[i] += data.size();
+      if (check) {
+        received[i] += data;
+      }
+      done += sizes[i] >= expected;
+    }
+  }
+
+  for (int i = 0; i < CLIENTS; i++) {
+    if (sizes[i] != expected) {
+      return false;
+    }
+    if (check && received[i] != packet.repeated(expected / PACKET_SIZE)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Every client gets every packet, in order, and nothing is left behind in
+ * the send buffers
+ */
+void benchmark_connection::buffered_sends()
+{
+  send_round(PACKETS);
+  for (const auto &pconn : conns) {
+    QVERIFY(!pconn.is_closing);
+    QCOMPARE(pconn.send_buffer->ndata, 0ul);
+    QCOMPARE(pconn.send_buffer->do_buffer_sends, 0);
+  }
+  QVERIFY(receive_all(qint64(PACKETS) * PACKET_SIZE, true));
+}
+
+/**
+ * A round of packets sent to every client and received
+ */
+void benchmark_connection::benchmark_broadcast()
+{
+  QBENCHMARK
+  {
+    send_round(PACKETS);
+    QVERIFY(receive_all(qint64(PACKETS) * PACKET_SIZE, false));
+  }
+}
+
+QTEST_GUILESS_MAIN(benchmark_connection)
+#include "benchmark_connection.moc"
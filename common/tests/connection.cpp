@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "timing.h"
+
+// common
+#include "connection.h"
+#include "fc_types.h" // MAX_LEN_PACKET
+
+// Qt
+#include <QBuffer>
+#include <QByteArray>
+#include <QtTest>
+
+// std
+#include <cstdlib> // free
+#include <memory>
+
+/**
+ * Tests how the connection send buffer hands data over to the socket
+ */
+class test_connection : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void init();
+  void cleanup();
+
+  void unbuffered();
+  void buffered();
+  void large_buffered();
+  void closed_socket();
+
+private:
+  QBuffer socket;
+  std::unique_ptr<connection> pconn;
+};
+
+namespace {
+/**
+ * Marks the connection as closing, as the server does
+ */
+void close_callback(struct connection *pconn) { pconn->is_closing = true; }
+
+/**
+ * A fake packet with recognizable contents
+ */
+QByteArray make_packet(int size, int seed)
+{
+  QByteArray packet(size, '\0');
+  for (int i = 0; i < size; i++) {
+    packet[i] = char((i + seed) % 251);
+  }
+  return packet;
+}
+} // anonymous namespace
+
+/**
+ * Sets the close callback
+ */
+void test_connection::initTestCase()
+{
+  connections_set_close_callback(close_callback);
+}
+
+/**
+ * Creates a connection writing to an in-memory socket
+ */
+void test_connection::init()
+{
+  socket.setData(QByteArray());
+  QVERIFY(socket.open(QIODevice::WriteOnly));
+
+  pconn = std::make_unique<connection>();
+  pconn->sock = &socket;
+  pconn->used = true;
+  pconn->is_closing = false;
+  pconn->last_write = nullptr;
+  pconn->send_buffer = new_socket_packet_buffer();
+  pconn->statistics.bytes_send = 0;
+}
+
+/**
+ * Frees the connection
+ */
+void test_connection::cleanup()
+{
+  free(pconn->send_buffer->data);
+  delete pconn->send_buffer;
+  timer_destroy(pconn->last_write);
+  pconn.reset();
+  socket.close();
+}
+
+/**
+ * Without buffering, data goes to the socket right away
+ */
+void test_connection::unbuffered()
+{
+  const auto packet = make_packet(100, 0);
+  QVERIFY(connection_send_data(pconn.get(), packet));
+  QCOMPARE(socket.data(), packet);
+  QCOMPARE(pconn->send_buffer->ndata, 0ul);
+  QVERIFY(pconn->last_write != nullptr);
+}
+
+/**
+ * With buffering, small packets are held back until unbuffering, then
+ * handed over in order
+ */
+void test_connection::buffered()
+{
+  const auto first = make_packet(100, 0);
+  const auto second = make_packet(200, 1);
+
+  connection_do_buffer(pconn.get());
+  QVERIFY(connection_send_data(pconn.get(), first));
+  QVERIFY(connection_send_data(pconn.get(), second));
+  QVERIFY(socket.data().isEmpty());
+  QCOMPARE(pconn->send_buffer->ndata, 300ul);
+
+  connection_do_unbuffer(pconn.get());
+  QCOMPARE(socket.data(), first + second);
+  QCOMPARE(pconn->send_buffer->ndata, 0ul);
+  QCOMPARE(pconn->statistics.bytes_send, 300);
+}
+
+/**
+ * With buffering, the whole send buffer is handed over once it holds a
+ * full packet worth of data
+ */
+void test_connection::large_buffered()
+{
+  const auto first = make_packet(MAX_LEN_PACKET - 1, 0);
+  const auto second = make_packet(10, 1);
+
+  connection_do_buffer(pconn.get());
+  QVERIFY(connection_send_data(pconn.get(), first));
+  QVERIFY(socket.data().isEmpty());
+
+  QVERIFY(connection_send_data(pconn.get(), second));
+  QCOMPARE(socket.data(), first + second);
+  QCOMPARE(pconn->send_buffer->ndata, 0ul);
+
+  connection_do_unbuffer(pconn.get());
+  QCOMPARE(socket.data(), first + second);
+}
+
+/**
+ * Writing to a closed socket closes the connection
+ */
+void test_connection::closed_socket()
+{
+  connection_do_buffer(pconn.get());
+  QVERIFY(connection_send_data(pconn.get(), make_packet(100, 0)));
+  socket.close();
+
+  connection_do_unbuffer(pconn.get());
+  QVERIFY(pconn->is_closing);
+  QVERIFY(!pconn->closing_reason.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(test_connection)
+#include "connection.moc"
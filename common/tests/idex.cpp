@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// common
+#include "idex.h"
+
+// Qt
+#include <QHash>
+#include <QtTest>
+
+// std
+#include <vector>
+
+/**
+ * Tests the id index
+ */
+class test_idex : public QObject {
+  Q_OBJECT
+
+private slots:
+  void lookup();
+  void out_of_range();
+  void iteration_order();
+
+  void benchmark_lookup_data();
+  void benchmark_lookup();
+  void benchmark_churn();
+};
+
+namespace {
+/// Number of objects in the benchmarks.
+constexpr int OBJECTS = 5000;
+/// Ids are handed out with gaps as objects are created and destroyed.
+constexpr int ID_STRIDE = 3;
+
+std::vector<int> objects(OBJECTS * ID_STRIDE);
+} // anonymous namespace
+
+/**
+ * Objects can be stored, found and removed
+ */
+void test_idex::lookup()
+{
+  idex_table<int> table;
+  QCOMPARE(table.size(), 0);
+  QCOMPARE(table.lookup(1), nullptr);
+
+  QCOMPARE(table.insert(1, &objects[1]), nullptr);
+  QCOMPARE(table.insert(100, &objects[100]), nullptr);
+  QCOMPARE(table.size(), 2);
+  QCOMPARE(table.lookup(1), &objects[1]);
+  QCOMPARE(table.lookup(100), &objects[100]);
+  QCOMPARE(table.lookup(50), nullptr);
+
+  // Replacing returns the old object
+  QCOMPARE(table.insert(1, &objects[2]), &objects[1]);
+  QCOMPARE(table.size(), 2);
+
+  QCOMPARE(table.remove(1), &objects[2]);
+  QCOMPARE(table.remove(1), nullptr);
+  QCOMPARE(table.lookup(1), nullptr);
+  QCOMPARE(table.size(), 1);
+}
+
+/**
+ * Ids that were never stored, including invalid ones, are not found.
+ * Invalid ids cannot be stored.
+ */
+void test_idex::out_of_range()
+{
+  idex_table<int> table;
+  table.insert(10, &objects[10]);
+
+  QCOMPARE(table.lookup(-1), nullptr);
+  QCOMPARE(table.lookup(11), nullptr);
+  QCOMPARE(table.lookup(1 << 30), nullptr);
+  QCOMPARE(table.remove(-1), nullptr);
+  QCOMPARE(table.remove(1 << 30), nullptr);
+  QCOMPARE(table.size(), 1);
+
+  // Negative ids cannot be stored
+  QCOMPARE(table.insert(-1, &objects[1]), nullptr);
+  QCOMPARE(table.lookup(-1), nullptr);
+  QCOMPARE(table.size(), 1);
+}
+
+/**
+ * Iteration visits every object once, in id order
+ */
+void test_idex::iteration_order()
+{
+  idex_table<int> table;
+  for (int id : {42, 7, 1000, 3}) {
+    table.insert(id, &objects[id]);
+  }
+  table.remove(42);
+
+  std::vector<int> ids;
+  table.for_each([&](int id, const int *object) {
+    QCOMPARE(object, &objects[id]);
+    ids.push_back(id);
+  });
+  QCOMPARE(ids, std::vector<int>({3, 7, 1000}));
+}
+
+/**
+ * Lookup throughput, with the QHash used previously as a reference
+ */
+void test_idex::benchmark_lookup_data()
+{
+  QTest::addColumn<bool>("flat");
+  QTest::newRow("idex_table") << true;
+  QTest::newRow("QHash") << false;
+}
+
+void test_idex::benchmark_lookup()
+{
+  QFETCH(bool, flat);
+
+  idex_table<int> table;
+  QHash<int, const int *> hash;
+  for (int i = 0; i < OBJECTS; i++) {
+    int id = i * ID_STRIDE + 1;
+    table.insert(id, &objects[id]);
+    hash.insert(id, &objects[id]);
+  }
+
+  int found = 0;
+  QBENCHMARK
+  {
+    // Look up every id, including those of dead objects
+    for (int id = 0; id < OBJECTS * ID_STRIDE; id++) {
+      found += (flat ? table.lookup(id) : hash.value(id)) != nullptr;
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+/**
+ * Creation and destruction of objects, interleaved with lookups as when
+ * replaying unit packets
+ */
+void test_idex::benchmark_churn()
+{
+  idex_table<int> table;
+  int found = 0;
+  QBENCHMARK
+  {
+    for (int i = 0; i < OBJECTS * ID_STRIDE; i++) {
+      table.insert(i, &objects[i]);
+      found += table.lookup(i / 2) != nullptr;
+      if (i % ID_STRIDE != 0) {
+        table.remove(i - 1);
+      }
+    }
+    for (int i = 0; i < OBJECTS * ID_STRIDE; i++) {
+      table.remove(i);
+    }
+  }
+  QVERIFY(found > 0);
+  QCOMPARE(table.size(), 0);
+}
+
+QTEST_GUILESS_MAIN(test_idex)
+#include "idex.moc"
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// common
+#include "fc_types.h"
+#include "packets.h"
+
+// Qt
+#include <QtTest>
+
+// std
+#include <vector>
+
+/**
+ * Tests the encoding of tile snapshot packets
+ */
+class test_tile_snapshot : public QObject {
+  Q_OBJECT
+
+private slots:
+  void round_trip();
+  void too_large();
+  void malformed();
+};
+
+namespace {
+/// Width of the test map.
+constexpr int WIDTH = 400;
+
+/**
+ * A row of tiles that looks like a real map: large areas of the same
+ * terrain and owner, with a few different tiles in between.
+ */
+std::vector<packet_tile_info> make_row(int first)
+{
+  std::vector<packet_tile_info> tiles(WIDTH);
+  for (int i = 0; i < WIDTH; i++) {
+    auto &info = tiles[i];
+    info.tile = first + i;
+    info.known = i < WIDTH / 4 ? TILE_UNKNOWN : TILE_KNOWN_SEEN;
+    info.continent = i < WIDTH / 2 ? -1 : 3;
+    info.owner = i % 100 < 60 ? 2 : MAX_NUM_PLAYER_SLOTS;
+    info.extras_owner = MAX_NUM_PLAYER_SLOTS;
+    info.worked = i == 250 ? 1234 : 0;
+    info.terrain = i / 50;
+    info.resource = i % 37 == 0 ? 5 : MAX_EXTRA_TYPES;
+    BV_CLR_ALL(info.extras);
+    if (i % 50 == 0) {
+      BV_SET(info.extras, 3);
+    }
+    info.placing = i == 300 ? 2 : -1;
+    info.place_turn = i == 300 ? 120 : 0;
+  }
+  return tiles;
+}
+} // anonymous namespace
+
+/**
+ * Decoding gives back the encoded tiles
+ */
+void test_tile_snapshot::round_trip()
+{
+  const auto tiles = make_row(WIDTH * 10);
+  packet_tile_snapshot packet;
+  QVERIFY(tile_snapshot_encode(&packet, tiles.data(), WIDTH));
+  QCOMPARE(packet.first, WIDTH * 10);
+  QCOMPARE(packet.count, WIDTH);
+  // Much smaller than one tile info per tile
+  QVERIFY(packet.length < WIDTH * 4);
+
+  std::vector<packet_tile_info> decoded;
+  QVERIFY(tile_snapshot_decode(&packet, decoded));
+  QCOMPARE(decoded.size(), tiles.size());
+  for (std::size_t i = 0; i < tiles.size(); i++) {
+    QCOMPARE(decoded[i].tile, tiles[i].tile);
+    QCOMPARE(decoded[i].known, tiles[i].known);
+    QCOMPARE(decoded[i].continent, tiles[i].continent);
+    QCOMPARE(decoded[i].owner, tiles[i].owner);
+    QCOMPARE(decoded[i].extras_owner, tiles[i].extras_owner);
+    QCOMPARE(decoded[i].worked, tiles[i].worked);
+    QCOMPARE(decoded[i].terrain, tiles[i].terrain);
+    QCOMPARE(decoded[i].resource, tiles[i].resource);
+    QVERIFY(BV_ARE_EQUAL(decoded[i].extras, tiles[i].extras));
+    QCOMPARE(decoded[i].placing, tiles[i].placing);
+    QCOMPARE(decoded[i].place_turn, tiles[i].place_turn);
+    QCOMPARE(decoded[i].label[0], '\0');
+  }
+}
+
+/**
+ * Tiles that don't compress well are rejected when they don't fit
+ */
+void test_tile_snapshot::too_large()
+{
+  std::vector<packet_tile_info> tiles;
+  for (int row = 0; row < 10; row++) {
+    auto more = make_row(row * WIDTH);
+    tiles.insert(tiles.end(), more.begin(), more.end());
+  }
+  // No two neighbours alike
+  for (std::size_t i = 0; i < tiles.size(); i++) {
+    tiles[i].worked = i;
+  }
+
+  packet_tile_snapshot packet;
+  QVERIFY(!tile_snapshot_encode(&packet, tiles.data(), tiles.size()));
+  QVERIFY(tile_snapshot_encode(&packet, tiles.data(), 100));
+}
+
+/**
+ * Truncated or inconsistent data is rejected
+ */
+void test_tile_snapshot::malformed()
+{
+  const auto tiles = make_row(0);
+  packet_tile_snapshot packet;
+  QVERIFY(tile_snapshot_encode(&packet, tiles.data(), WIDTH));
+
+  std::vector<packet_tile_info> decoded;
+  auto truncated = packet;
+  truncated.length--;
+  QVERIFY(!tile_snapshot_decode(&truncated, decoded));
+
+  auto shorter = packet;
+  shorter.count--;
+  QVERIFY(!tile_snapshot_decode(&shorter, decoded));
+
+  auto oversized = packet;
+  oversized.length = TILE_SNAPSHOT_SIZE + 1;
+  QVERIFY(!tile_snapshot_decode(&oversized, decoded));
+}
+
+QTEST_GUILESS_MAIN(test_tile_snapshot)
+#include "tile_snapshot.moc"
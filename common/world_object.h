@@ -6,14 +6,12 @@
 // common
 #include "city.h"
 #include "fc_types.h"
+#include "idex.h"
 #include "map_types.h"
 #include "unit.h"
 
-// Qt
-#include <QHash>
-
 struct world {
   struct civ_map map;
-  QHash<int, const struct city *> *cities;
-  QHash<int, const struct unit *> *units;
+  idex_table<struct city> *cities;
+  idex_table<struct unit> *units;
 };
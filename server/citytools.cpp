@@ -57,6 +57,7 @@
 #include "notify.h"
 #include "plrhand.h"
 #include "sanitycheck.h"
+#include "sendqueue.h"
 #include "sernet.h"
 #include "server_connection.h"
 #include "srv_main.h"
@@ -2274,6 +2275,10 @@ void send_city_info(struct player *dest, struct city *pcity)
     return;
   }
 
+  if (send_queue_city(pcity, dest)) {
+    return;
+  }
+
   if (!dest || dest == powner) {
     pcity->server.synced = true;
   }
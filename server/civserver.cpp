@@ -231,10 +231,16 @@ int main(int argc, char *argv[])
        _("DIR")},
       {{"t", "timetrack"},
        _("Prints stats about elapsed time on misc tasks.")},
+      {"mapgen-bench",
+       _("Prints the time spent in each stage of map generation.")},
       {{"w", "warnings"}, _("Warn about deprecated modpack constructs.")},
       {"ruleset", _("Load ruleset RULESET."),
        // TRANS: Command-line argument
        _("RULESET")},
+      {"ruleset-cache",
+       _("Keep parsed ruleset files in directory DIR for faster loading."),
+       // TRANS: Command-line argument
+       _("DIR")},
       {"scenarios", _("Save scenarios to directory DIR."),
        // TRANS: Command-line argument
        _("DIR")},
@@ -345,6 +351,9 @@ int main(int argc, char *argv[])
     srvarg.timetrack = true;
     log_time(QStringLiteral("Time tracking enabled"), true);
   }
+  if (parser.isSet(QStringLiteral("mapgen-bench"))) {
+    srvarg.mapgen_bench = true;
+  }
   if (parser.isSet("Database")) {
     srvarg.fcdb_enabled = true;
     srvarg.fcdb_conf = parser.value("Database");
@@ -370,6 +379,10 @@ int main(int argc, char *argv[])
   if (parser.isSet(QStringLiteral("ruleset"))) {
     srvarg.ruleset = parser.value(QStringLiteral("ruleset"));
   }
+  if (parser.isSet(QStringLiteral("ruleset-cache"))) {
+    srvarg.ruleset_cache_pathname =
+        parser.value(QStringLiteral("ruleset-cache"));
+  }
   if (parser.isSet(QStringLiteral("Announce"))) {
     auto value = parser.value(QStringLiteral("Announce")).toLower();
     if (value == QLatin1String("ipv4")) {
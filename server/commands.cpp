@@ -605,6 +605,10 @@ static struct command commands[] = {
         "lua unsafe-cmd <script line>\n"
         "lua file <script file>\n"
         "lua unsafe-file <script file>\n"
+        "lua signals\n"
+        "lua profile start|stop|report\n"
+        "lua profile dump <file>\n"
+        "lua profile budget <milliseconds>\n"
         "lua <script line> (deprecated)"),
      N_("Evaluate a line of Freeciv21 script or a Freeciv21 script file in "
         "the current game."),
@@ -612,7 +616,15 @@ static struct command commands[] = {
         "ruleset. This instance doesn't restrict access to Lua functions "
         "that can be used to hack the computer running the Freeciv21 "
         "server. Access to it is therefore limited to the console and "
-        "connections with cmdlevel 'hack'"),
+        "connections with cmdlevel 'hack'.\n"
+        "'lua signals' shows how many times each script signal was emitted "
+        "and how much time its callbacks took.\n"
+        "'lua profile' measures the time and instructions spent in every "
+        "Lua function of the ruleset and scenario scripts. 'report' lists "
+        "the most expensive ones, and 'dump' writes the profile in the "
+        "folded stack format used by flame graph tools. 'budget' sets a "
+        "time after which slow signal callbacks are reported in the log; "
+        "0 disables it."),
      nullptr, CMD_ECHO_ADMINS, VCF_NONE, 0},
     {"kick", ALLOW_CTRL,
      // TRANS: translate text between <>
@@ -712,34 +712,32 @@ static bool connection_attach_real(server_connection *pconn,
       break;
 
     case S_S_RUNNING:
-      conn_compression_freeze(pconn);
-      send_all_info(pconn->self);
-      if (game.info.is_edit_mode && can_conn_edit(pconn)) {
-        edithand_send_initial_packets(pconn->self);
-      }
-      conn_compression_thaw(pconn);
-      // Enter C_S_RUNNING client state.
-      dsend_packet_start_phase(pconn, game.info.phase);
-      // Must be after C_S_RUNNING client state to be effective.
-      send_diplomatic_meetings(pconn);
-      send_pending_events(pconn, connecting);
-      send_running_votes(pconn, !connecting);
+      send_all_info_streamed(pconn, [connecting](server_connection *pc) {
+        if (game.info.is_edit_mode && can_conn_edit(pc)) {
+          edithand_send_initial_packets(pc->self);
+        }
+        // Enter C_S_RUNNING client state.
+        dsend_packet_start_phase(pc, game.info.phase);
+        // Must be after C_S_RUNNING client state to be effective.
+        send_diplomatic_meetings(pc);
+        send_pending_events(pc, connecting);
+        send_running_votes(pc, !connecting);
+      });
       break;
 
     case S_S_OVER:
-      conn_compression_freeze(pconn);
-      send_all_info(pconn->self);
-      if (game.info.is_edit_mode && can_conn_edit(pconn)) {
-        edithand_send_initial_packets(pconn->self);
-      }
-      conn_compression_thaw(pconn);
-      report_final_scores(pconn->self);
-      send_pending_events(pconn, connecting);
-      send_running_votes(pconn, !connecting);
-      if (!connecting) {
-        // Send information about delegation(s).
-        send_delegation_info(pconn);
-      }
+      send_all_info_streamed(pconn, [connecting](server_connection *pc) {
+        if (game.info.is_edit_mode && can_conn_edit(pc)) {
+          edithand_send_initial_packets(pc->self);
+        }
+        report_final_scores(pc->self);
+        send_pending_events(pc, connecting);
+        send_running_votes(pc, !connecting);
+        if (!connecting) {
+          // Send information about delegation(s).
+          send_delegation_info(pc);
+        }
+      });
       break;
     }
   }
@@ -774,6 +772,8 @@ void connection_detach(server_connection *pconn, bool remove_unused_player)
 
   fc_assert_ret(pconn != nullptr);
 
+  cancel_info_stream(pconn);
+
   if (nullptr != (pplayer = pconn->playing)) {
     bool was_connected = pplayer->is_connected;
 
@@ -14,6 +14,7 @@
 #include <fc_config.h>
 
 #include <QBitArray>
+#include <QElapsedTimer>
 #include <cstdlib>
 #include <cstring>
 // utility
@@ -28,6 +29,9 @@
 #include "map.h"
 #include "road.h"
 
+// server
+#include "srv_main.h"
+
 /* server/generator */
 #include "fair_islands.h"
 #include "fracture_map.h"
@@ -43,6 +47,9 @@
 struct extra_type *river_types[MAX_ROAD_TYPES];
 int river_type_count = 0;
 
+// Measures the current map generator stage for --mapgen-bench.
+static QElapsedTimer mapgen_stage_timer;
+
 static void make_huts(int number);
 static void add_resources(int prob);
 static void adjust_terrain_param();
@@ -87,6 +94,7 @@ static bool make_river(struct river_map *privermap, struct tile *ptile,
 static void make_rivers();
 
 static void river_types_init();
+static void mapgen_stage_done(const char *stage);
 
 /* These are the old parameters of terrains types in %
    TODO: they depend on the hardcoded terrains */
@@ -1079,6 +1087,7 @@ static void make_land()
   destroy_tmap();
   // ... and create a real temperature map (needs hmap and oceans)
   create_tmap(true);
+  mapgen_stage_done("land and oceans");
 
   if (HAS_POLES) {     /* this is a hack to terrains set with not frizzed
                           oceans*/
@@ -1092,10 +1101,13 @@ static void make_land()
   } else {
     make_relief(); // base relief on map
   }
+  mapgen_stage_done("relief");
   make_terrains(); // place all exept mountains and hill
   destroy_placed_map();
+  mapgen_stage_done("terrains");
 
   make_rivers(); // use a new placed_map. destroy older before call
+  mapgen_stage_done("rivers");
 }
 
 /**
@@ -1240,6 +1252,7 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
     fc_srand(wld.map.server.seed_setting);
   }
   wld.map.server.seed = wld.map.server.seed_setting;
+  mapgen_stage_timer.start();
 
   /* don't generate tiles with mapgen == MAPGEN_SCENARIO as we've loaded *
      them from file.
@@ -1255,6 +1268,7 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
       main_map_allocate();
     }
     adjust_terrain_param();
+    mapgen_stage_done("topology");
     // if one mapgenerator fails, it will choose another mapgenerator
     // with a lower number to try again
 
@@ -1282,6 +1296,7 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
     if (MAPGEN_FRACTURE == wld.map.server.generator) {
       make_fracture_hmap();
     }
+    mapgen_stage_done("height map");
 
     // if hmap only generator make anything else
     if (MAPGEN_RANDOM == wld.map.server.generator
@@ -1305,6 +1320,7 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
   } else {
     assign_continent_numbers();
   }
+  mapgen_stage_done("continents and lakes");
 
   // create a temperature map if it was not done before
   if (!temperature_is_initialized()) {
@@ -1319,6 +1335,7 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
   if (!wld.map.server.have_huts) {
     make_huts(wld.map.server.huts * map_num_tiles() / 1000);
   }
+  mapgen_stage_done("resources and huts");
 
   // restore previous random state:
   fc_rand_set_state(rstate);
@@ -1395,6 +1412,8 @@ bool map_generate(bool autosize, struct unit_type *initial_unit)
     }
   }
 
+  mapgen_stage_done("start positions");
+
   // destroy temperature map
   destroy_tmap();
 
@@ -1547,3 +1566,16 @@ static void river_types_init()
   }
   extra_type_by_cause_iterate_end;
 }
+
+/**
+   Reports the time spent since the previous stage of map generation when
+   the server runs with --mapgen-bench, and starts timing the next stage.
+ */
+static void mapgen_stage_done(const char *stage)
+{
+  if (srvarg.mapgen_bench) {
+    qInfo("Map generator stage \"%s\": %.3f ms", stage,
+          mapgen_stage_timer.nsecsElapsed() / 1e6);
+  }
+  mapgen_stage_timer.restart();
+}
@@ -10,6 +10,7 @@ _   ._       Copyright (c) 1996-2021 Freeciv21 and Freeciv contributors.
  */
 // utility
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "rand.h"
 #include "support.h" // bool type
@@ -21,6 +22,11 @@ _   ._       Copyright (c) 1996-2021 Freeciv21 and Freeciv contributors.
 
 #include "mapgen_utils.h"
 
+// std
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 /**
  Map that contains, according to circumstances, information on whether
  we have already placed terrain (special, hut) here.
@@ -104,23 +110,55 @@ void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
                              bool (*filter)(const struct tile *ptile,
                                             const void *data))
 {
+  struct adjust_chunk {
+    int minval = 0, maxval = 0, total = 0;
+    std::vector<int> frequencies;
+  };
+  const int xsize = wld.map.xsize;
+  const int rows = wld.map.ysize;
+  // One accumulator per row keeps the reduction independent of how the
+  // rows get distributed over threads.
+  std::vector<adjust_chunk> chunks(rows);
   int minval = 0, maxval = 0, total = 0;
-  bool first = true;
 
-  // Determine minimum and maximum value.
-  whole_map_iterate_filtered(ptile, data, filter)
-  {
-    if (first) {
-      minval = int_map[tile_index(ptile)];
-      maxval = int_map[tile_index(ptile)];
+  /* Determine minimum and maximum value. The filter is only a predicate on
+   * the tile and is safe to call concurrently. */
+  fc_parallel_for(0, rows, [&](int ymin, int ymax) {
+    for (int y = ymin; y < ymax; y++) {
+      adjust_chunk &chunk = chunks[y];
+
+      for (int x = 0; x < xsize; x++) {
+        const struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
+        const int value = int_map[tile_index(ptile)];
+
+        if (nullptr != filter && !filter(ptile, data)) {
+          continue;
+        }
+        if (0 == chunk.total) {
+          chunk.minval = value;
+          chunk.maxval = value;
+        } else {
+          chunk.maxval = MAX(chunk.maxval, value);
+          chunk.minval = MIN(chunk.minval, value);
+        }
+        chunk.total++;
+      }
+    }
+  });
+
+  for (const auto &chunk : chunks) {
+    if (0 == chunk.total) {
+      continue;
+    }
+    if (0 == total) {
+      minval = chunk.minval;
+      maxval = chunk.maxval;
     } else {
-      maxval = MAX(maxval, int_map[tile_index(ptile)]);
-      minval = MIN(minval, int_map[tile_index(ptile)]);
+      maxval = MAX(maxval, chunk.maxval);
+      minval = MIN(minval, chunk.minval);
     }
-    first = false;
-    total++;
+    total += chunk.total;
   }
-  whole_map_iterate_filtered_end;
 
   if (total == 0) {
     return;
@@ -128,32 +166,61 @@ void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
 
   {
     int const size = 1 + maxval - minval;
-    int i, count = 0, frequencies[size];
-
-    INITIALIZE_ARRAY(frequencies, size, 0);
+    int count = 0;
+    std::vector<int> frequencies(size, 0);
 
     /* Translate value so the minimum value is 0
        and count the number of occurencies of all values to initialize the
-       frequencies[] */
-    whole_map_iterate_filtered(ptile, data, filter)
-    {
-      int_map[tile_index(ptile)] -= minval;
-      frequencies[int_map[tile_index(ptile)]]++;
+       frequencies[]. Rows are grouped so that each group owns a single
+       histogram, which are then summed up. */
+    const int groups = MIN(rows, 16);
+    std::vector<std::vector<int>> group_frequencies(groups);
+
+    fc_parallel_for(0, groups, [&](int gmin, int gmax) {
+      for (int g = gmin; g < gmax; g++) {
+        std::vector<int> &freq = group_frequencies[g];
+
+        freq.assign(size, 0);
+        for (int y = rows * g / groups; y < rows * (g + 1) / groups; y++) {
+          for (int x = 0; x < xsize; x++) {
+            const struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
+
+            if (nullptr != filter && !filter(ptile, data)) {
+              continue;
+            }
+            int_map[tile_index(ptile)] -= minval;
+            freq[int_map[tile_index(ptile)]]++;
+          }
+        }
+      }
+    });
+
+    for (const auto &freq : group_frequencies) {
+      for (int i = 0; i < size; i++) {
+        frequencies[i] += freq[i];
+      }
     }
-    whole_map_iterate_filtered_end;
 
     // create the linearize function as "incremental" frequencies
-    for (i = 0; i < size; i++) {
+    for (int i = 0; i < size; i++) {
       count += frequencies[i];
       frequencies[i] = (count * int_map_max) / total;
     }
 
     // apply the linearize function
-    whole_map_iterate_filtered(ptile, data, filter)
-    {
-      int_map[tile_index(ptile)] = frequencies[int_map[tile_index(ptile)]];
-    }
-    whole_map_iterate_filtered_end;
+    fc_parallel_for(0, rows, [&](int ymin, int ymax) {
+      for (int y = ymin; y < ymax; y++) {
+        for (int x = 0; x < xsize; x++) {
+          const struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
+
+          if (nullptr != filter && !filter(ptile, data)) {
+            continue;
+          }
+          int_map[tile_index(ptile)] =
+              frequencies[int_map[tile_index(ptile)]];
+        }
+      }
+    });
   }
 }
 
@@ -162,6 +229,10 @@ void adjust_int_map_filtered(int *int_map, int int_map_max, void *data,
    MAP_INDEX_SIZE and the map is indexed by native_pos_to_index function.
    If zeroes_at_edges is set, any unreal position on diffusion has 0 value
    if zeroes_at_edges in unset the unreal position are not counted.
+
+   Every tile only reads from the source map, so both passes are run in
+   parallel over the native rows; the result does not depend on the number
+   of threads.
  */
 void smooth_int_map(int *int_map, bool zeroes_at_edges)
 {
@@ -179,22 +250,25 @@ void smooth_int_map(int *int_map, bool zeroes_at_edges)
   source_map = int_map;
 
   do {
-    whole_map_iterate(&(wld.map), ptile)
-    {
-      float N = 0, D = 0;
-
-      axis_iterate(&(wld.map), ptile, pnear, i, 2, axe)
-      {
-        D += weight[i + 2];
-        N += weight[i + 2] * source_map[tile_index(pnear)];
-      }
-      axis_iterate_end;
-      if (zeroes_at_edges) {
-        D = 1;
+    fc_parallel_for(0, wld.map.ysize, [&](int ymin, int ymax) {
+      for (int y = ymin; y < ymax; y++) {
+        for (int x = 0; x < wld.map.xsize; x++) {
+          struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
+          float N = 0, D = 0;
+
+          axis_iterate(&(wld.map), ptile, pnear, i, 2, axe)
+          {
+            D += weight[i + 2];
+            N += weight[i + 2] * source_map[tile_index(pnear)];
+          }
+          axis_iterate_end;
+          if (zeroes_at_edges) {
+            D = 1;
+          }
+          target_map[tile_index(ptile)] = N / D;
+        }
       }
-      target_map[tile_index(ptile)] = N / D;
-    }
-    whole_map_iterate_end;
+    });
 
     if (MAP_IS_ISOMETRIC) {
       weight = weight_isometric;
@@ -259,6 +333,27 @@ static void recalculate_lake_surrounders()
   whole_map_iterate_end;
 }
 
+/**
+   Returns whether the tile belongs to a body of the given kind: a
+   continent if is_land is set, an ocean otherwise.
+ */
+static bool is_body_tile(const struct tile *ptile, bool is_land)
+{
+  const struct terrain *pterrain = tile_terrain(ptile);
+
+  return T_UNKNOWN != pterrain
+         && XOR(is_land, terrain_type_terrain_class(pterrain) == TC_OCEAN);
+}
+
+/**
+   Returns the size counter of the given continent or (negative) ocean
+   number.
+ */
+static int &body_size(Continent_id nr)
+{
+  return nr < 0 ? ocean_sizes[-nr] : continent_sizes[nr];
+}
+
 /**
    Number this tile and nearby tiles with the specified continent number
  'nr'. Due to the number of recursion for large maps a non-recursive
@@ -269,58 +364,36 @@ static void recalculate_lake_surrounders()
  */
 static void assign_continent_flood(struct tile *ptile, bool is_land, int nr)
 {
-  struct tile_list *tlist = nullptr;
-  const struct terrain *pterrain = nullptr;
+  std::vector<struct tile *> stack;
 
   fc_assert_ret(ptile != nullptr);
 
-  pterrain = tile_terrain(ptile);
   /* Check if the initial tile is a valid tile for continent / ocean. */
-  fc_assert_ret(
-      tile_continent(ptile) == 0 && T_UNKNOWN != pterrain
-      && XOR(is_land, terrain_type_terrain_class(pterrain) == TC_OCEAN));
+  fc_assert_ret(tile_continent(ptile) == 0 && is_body_tile(ptile, is_land));
 
-  // Create tile list and insert the initial tile.
-  tlist = tile_list_new();
-  tile_list_append(tlist, ptile);
+  /* Tiles are numbered as soon as they are found so that each of them is
+   * only visited once. */
+  tile_set_continent(ptile, nr);
+  stack.push_back(ptile);
 
-  while (tile_list_size(tlist) > 0) {
-    // Iterate over all unchecked tiles.
-    tile_list_iterate(tlist, ptile2)
-    {
-      // Iterate over the adjacent tiles.
-      adjc_iterate(&(wld.map), ptile2, ptile3)
-      {
-        pterrain = tile_terrain(ptile3);
+  while (!stack.empty()) {
+    struct tile *ptile2 = stack.back();
 
-        // Check if it is a valid tile for continent / ocean.
-        if (tile_continent(ptile3) != 0 || T_UNKNOWN == pterrain
-            || !XOR(is_land,
-                    terrain_type_terrain_class(pterrain) == TC_OCEAN)) {
-          continue;
-        }
-
-        // Add the tile to the list of tiles to check.
-        if (!tile_list_search(tlist, ptile3)) {
-          tile_list_append(tlist, ptile3);
-        }
-      }
-      adjc_iterate_end;
+    stack.pop_back();
+    // count the tile
+    body_size(nr)++;
 
-      // Set the continent data and remove the tile from the list.
-      tile_set_continent(ptile2, nr);
-      tile_list_remove(tlist, ptile2);
-      // count the tile
-      if (nr < 0) {
-        ocean_sizes[-nr]++;
-      } else {
-        continent_sizes[nr]++;
+    // Iterate over the adjacent tiles.
+    adjc_iterate(&(wld.map), ptile2, ptile3)
+    {
+      // Check if it is a valid tile for continent / ocean.
+      if (tile_continent(ptile3) == 0 && is_body_tile(ptile3, is_land)) {
+        tile_set_continent(ptile3, nr);
+        stack.push_back(ptile3);
       }
     }
-    tile_list_iterate_end;
+    adjc_iterate_end;
   }
-
-  tile_list_destroy(tlist);
 }
 
 /**
@@ -477,6 +550,314 @@ void assign_continent_numbers()
          wld.map.num_oceans);
 }
 
+/**
+   Returns an unused continent number (or ocean number if is_land is not
+   set), reusing the numbers of bodies that vanished before allocating a new
+   one.
+ */
+static Continent_id new_body_number(bool is_land)
+{
+  if (is_land) {
+    for (int nr = 1; nr <= wld.map.num_continents; nr++) {
+      if (continent_sizes[nr] == 0) {
+        return nr;
+      }
+    }
+    wld.map.num_continents++;
+    continent_sizes.push_back(0);
+    return wld.map.num_continents;
+  } else {
+    for (int nr = 1; nr <= wld.map.num_oceans; nr++) {
+      if (ocean_sizes[nr] == 0) {
+        return -nr;
+      }
+    }
+    wld.map.num_oceans++;
+    ocean_sizes.push_back(0);
+    lake_surrounders.push_back(0);
+    return -wld.map.num_oceans;
+  }
+}
+
+/**
+   Renumbers all tiles connected to ptile that have the number 'from' to
+   'to', and appends them to 'changed'.
+ */
+static void relabel_body(struct tile *ptile, Continent_id from,
+                         Continent_id to, std::vector<struct tile *> &changed)
+{
+  std::vector<struct tile *> stack;
+
+  fc_assert_ret(tile_continent(ptile) == from);
+
+  tile_set_continent(ptile, to);
+  stack.push_back(ptile);
+
+  while (!stack.empty()) {
+    struct tile *ptile2 = stack.back();
+
+    stack.pop_back();
+    changed.push_back(ptile2);
+    body_size(from)--;
+    body_size(to)++;
+
+    adjc_iterate(&(wld.map), ptile2, ptile3)
+    {
+      if (tile_continent(ptile3) == from) {
+        tile_set_continent(ptile3, to);
+        stack.push_back(ptile3);
+      }
+    }
+    adjc_iterate_end;
+  }
+}
+
+/**
+   Called after the tile numbered 'nr' left its body: checks whether the
+   remaining tiles around it still form a single body, and gives new
+   numbers to the parts that got cut off.
+
+   The searches started from each neighbour are run in lockstep and merged
+   as soon as they meet, so the cost is proportional to the size of the
+   parts that get cut off rather than to the size of the body.
+ */
+static void split_body(struct tile *ptile, Continent_id nr,
+                       std::vector<struct tile *> &changed)
+{
+  struct search {
+    int parent;
+    bool exhausted;
+    size_t head;
+    std::vector<struct tile *> tiles;
+  };
+  std::vector<search> searches;
+  std::unordered_map<int, int> owner;
+  int live = 0, roots = 0;
+
+  auto find = [&searches](int i) {
+    while (searches[i].parent != i) {
+      i = searches[i].parent = searches[searches[i].parent].parent;
+    }
+    return i;
+  };
+
+  adjc_iterate(&(wld.map), ptile, adjc)
+  {
+    if (tile_continent(adjc) == nr && !owner.count(tile_index(adjc))) {
+      int i = searches.size();
+
+      searches.push_back({i, false, 0, {adjc}});
+      owner[tile_index(adjc)] = i;
+    }
+  }
+  adjc_iterate_end;
+
+  live = roots = searches.size();
+  while (roots > 1 && live > 1) {
+    for (int i = 0; i < static_cast<int>(searches.size()); i++) {
+      search &psearch = searches[i];
+
+      if (psearch.parent != i || psearch.exhausted) {
+        continue;
+      }
+      if (psearch.head >= psearch.tiles.size()) {
+        psearch.exhausted = true;
+        live--;
+        continue;
+      }
+
+      struct tile *ptile2 = psearch.tiles[psearch.head++];
+
+      adjc_iterate(&(wld.map), ptile2, ptile3)
+      {
+        if (tile_continent(ptile3) != nr) {
+          continue;
+        }
+
+        auto found = owner.find(tile_index(ptile3));
+        if (found == owner.end()) {
+          owner[tile_index(ptile3)] = i;
+          psearch.tiles.push_back(ptile3);
+        } else if (int other = find(found->second); other != i) {
+          /* Both searches are in the same part. Move the tiles still to be
+           * expanded of the other search to the end of this one. */
+          search &osearch = searches[other];
+
+          psearch.tiles.insert(psearch.tiles.end(),
+                               osearch.tiles.begin() + osearch.head,
+                               osearch.tiles.end());
+          psearch.tiles.insert(psearch.tiles.begin() + psearch.head,
+                               osearch.tiles.begin(),
+                               osearch.tiles.begin() + osearch.head);
+          psearch.head += osearch.head;
+          osearch.tiles.clear();
+          osearch.parent = i;
+          roots--;
+          live--;
+        }
+      }
+      adjc_iterate_end;
+    }
+  }
+
+  if (roots <= 1) {
+    return;
+  }
+
+  /* Every exhausted search is a complete part. The part that is still
+   * being searched (or the largest one if all are done) keeps the old
+   * number. */
+  int keep = -1;
+  for (int i = 0; i < static_cast<int>(searches.size()); i++) {
+    if (searches[i].parent != i) {
+      continue;
+    }
+    if (keep < 0 || !searches[i].exhausted
+        || (searches[keep].exhausted
+            && searches[i].tiles.size() > searches[keep].tiles.size())) {
+      keep = i;
+    }
+  }
+
+  for (int i = 0; i < static_cast<int>(searches.size()); i++) {
+    if (searches[i].parent != i || i == keep) {
+      continue;
+    }
+    relabel_body(searches[i].tiles.front(), nr, new_body_number(nr > 0),
+                 changed);
+  }
+}
+
+/**
+   Recalculates lake_surrounders[] for a single ocean, starting from one of
+   its tiles. Stops as soon as a second adjacent continent is found.
+ */
+static void recalculate_lake_surrounders_of(struct tile *ptile)
+{
+  Continent_id ocean = tile_continent(ptile);
+  Continent_id surrounder = 0;
+  std::vector<struct tile *> stack;
+  std::unordered_set<int> visited;
+
+  fc_assert_ret(ocean < 0);
+
+  stack.push_back(ptile);
+  visited.insert(tile_index(ptile));
+  while (!stack.empty() && surrounder != -1) {
+    struct tile *ptile2 = stack.back();
+
+    stack.pop_back();
+    adjc_iterate(&(wld.map), ptile2, ptile3)
+    {
+      Continent_id cont = tile_continent(ptile3);
+
+      if (cont == ocean) {
+        if (visited.insert(tile_index(ptile3)).second) {
+          stack.push_back(ptile3);
+        }
+      } else if (cont > 0 && is_body_tile(ptile3, true)) {
+        if (surrounder == 0) {
+          surrounder = cont;
+        } else if (surrounder != cont) {
+          surrounder = -1;
+          break;
+        }
+      }
+    }
+    adjc_iterate_end;
+  }
+
+  lake_surrounders[-ocean] = surrounder;
+}
+
+/**
+   Updates the continent and ocean numbers after the terrain of a single
+   tile changed from land to ocean or back. Only the bodies touching the
+   tile are renumbered: the old body of the tile may be split, and the
+   bodies it now connects are merged into the largest of them. Continent
+   and ocean sizes and lake_surrounders[] are updated accordingly.
+
+   Numbers of bodies that vanish are reused later, so the numbering is not
+   necessarily the one assign_continent_numbers() would produce.
+
+   Returns all tiles whose number changed, including ptile itself.
+ */
+std::vector<struct tile *> update_continent_numbers(struct tile *ptile)
+{
+  std::vector<struct tile *> changed;
+  Continent_id old_nr = tile_continent(ptile);
+  bool is_land;
+
+  if (T_UNKNOWN == tile_terrain(ptile)) {
+    return changed;
+  }
+  is_land = is_body_tile(ptile, true);
+  if (old_nr != 0 && (old_nr > 0) == is_land) {
+    // Still the same kind of body.
+    return changed;
+  }
+
+  // Take the tile out of its old body.
+  if (old_nr != 0) {
+    tile_set_continent(ptile, 0);
+    body_size(old_nr)--;
+    split_body(ptile, old_nr, changed);
+  }
+
+  // Join the neighbouring bodies of the new kind into the largest one.
+  Continent_id new_nr = 0;
+  adjc_iterate(&(wld.map), ptile, adjc)
+  {
+    Continent_id nr = tile_continent(adjc);
+
+    if (nr != 0 && (nr > 0) == is_land
+        && (new_nr == 0 || body_size(nr) > body_size(new_nr))) {
+      new_nr = nr;
+    }
+  }
+  adjc_iterate_end;
+
+  if (new_nr == 0) {
+    new_nr = new_body_number(is_land);
+  } else {
+    adjc_iterate(&(wld.map), ptile, adjc)
+    {
+      Continent_id nr = tile_continent(adjc);
+
+      if (nr != 0 && nr != new_nr && (nr > 0) == is_land) {
+        relabel_body(adjc, nr, new_nr, changed);
+      }
+    }
+    adjc_iterate_end;
+  }
+  tile_set_continent(ptile, new_nr);
+  body_size(new_nr)++;
+  changed.push_back(ptile);
+
+  /* The surrounders may have changed for all oceans next to a renumbered
+   * tile. */
+  std::unordered_set<Continent_id> oceans;
+  for (auto *ptile2 : changed) {
+    if (tile_continent(ptile2) < 0
+        && oceans.insert(tile_continent(ptile2)).second) {
+      recalculate_lake_surrounders_of(ptile2);
+    }
+    adjc_iterate(&(wld.map), ptile2, adjc)
+    {
+      if (tile_continent(adjc) < 0
+          && oceans.insert(tile_continent(adjc)).second) {
+        recalculate_lake_surrounders_of(adjc);
+      }
+    }
+    adjc_iterate_end;
+  }
+  if (old_nr < 0 && ocean_sizes[-old_nr] == 0) {
+    lake_surrounders[-old_nr] = 0;
+  }
+
+  return changed;
+}
+
 /**
    Return most shallow ocean terrain type. Prefers not to return freshwater
    terrain, and will ignore 'frozen' rather than do so.
@@ -10,6 +10,9 @@
 **************************************************************************/
 #pragma once
 
+// std
+#include <vector>
+
 #define MG_UNUSED mapgen_terrain_property_invalid()
 
 void generator_free();
@@ -17,6 +20,7 @@ void generator_free();
 void regenerate_lakes();
 void smooth_water_depth();
 void assign_continent_numbers();
+std::vector<struct tile *> update_continent_numbers(struct tile *ptile);
 int get_lake_surrounders(Continent_id cont);
 int get_continent_size(Continent_id id);
 int get_ocean_size(Continent_id id);
@@ -13,6 +13,8 @@
 
 #include <QBitArray>
 #include <cmath> // sqrt, HUGE_VAL
+#include <map>
+#include <tuple> // std::tie
 
 // utility
 #include "distribute.h"
@@ -20,6 +22,7 @@
 #include "log.h"
 
 // common
+#include "effects.h"
 #include "game.h"
 #include "map.h"
 #include "map_types.h"
@@ -40,27 +43,124 @@ struct islands_data_type {
 static struct islands_data_type *islands;
 static int *islands_index;
 
+/**
+   Everything city_tile_output() looks at on a tile without a city, owner
+   or units. Used to share the output sums between all tiles with the same
+   terrain, resource and extras.
+ */
+struct tile_output_key {
+  const struct terrain *terrain;
+  const struct extra_type *resource;
+  bv_extras extras;
+
+  bool operator<(const tile_output_key &other) const
+  {
+    return std::tie(terrain, resource, extras.vec)
+           < std::tie(other.terrain, other.resource, other.extras.vec);
+  }
+};
+
+/**
+   State shared by all get_tile_value() calls of one
+   create_start_positions() run.
+ */
+struct tile_value_context {
+  // Virtual tile reused for the roaded, irrigated and mined variants.
+  struct tile *scratch;
+  // Whether the ruleset allows sharing outputs between tiles at all.
+  bool cacheable;
+  std::map<tile_output_key, int> outputs;
+};
+
+/**
+   Returns whether the tile outputs only depend on the tile itself, that is
+   no output effect has a requirement looking at the adjacent tiles or the
+   continent.
+ */
+static bool tile_outputs_are_local()
+{
+  const enum effect_type types[] = {
+      EFT_MINING_PCT,      EFT_IRRIGATION_PCT,      EFT_OUTPUT_ADD_TILE,
+      EFT_OUTPUT_INC_TILE, EFT_OUTPUT_PENALTY_TILE, EFT_OUTPUT_PER_TILE,
+      EFT_OUTPUT_TILE_PUNISH_PCT};
+
+  for (auto type : types) {
+    effect_list_iterate(get_effects(type), peffect)
+    {
+      requirement_vector_iterate(&peffect->reqs, preq)
+      {
+        if (preq->range == REQ_RANGE_CADJACENT
+            || preq->range == REQ_RANGE_ADJACENT
+            || preq->range == REQ_RANGE_CONTINENT) {
+          return false;
+        }
+      }
+      requirement_vector_iterate_end;
+    }
+    effect_list_iterate_end;
+  }
+
+  return true;
+}
+
+/**
+   Returns the sum of all outputs of the tile when worked without a city.
+ */
+static int tile_output_sum(struct tile_value_context *ctx,
+                           const struct tile *ptile)
+{
+  auto compute = [ptile] {
+    int value = 0;
+
+    output_type_iterate(o)
+    {
+      value += city_tile_output(nullptr, ptile, false,
+                                static_cast<Output_type_id>(o));
+    }
+    output_type_iterate_end;
+
+    return value;
+  };
+
+  if (!ctx->cacheable || nullptr != ptile->owner
+      || nullptr != ptile->extras_owner || nullptr != ptile->worked
+      || (nullptr != ptile->units && unit_list_size(ptile->units) > 0)) {
+    return compute();
+  }
+
+  tile_output_key key{ptile->terrain, ptile->resource, ptile->extras};
+  auto it = ctx->outputs.find(key);
+  if (it == ctx->outputs.end()) {
+    it = ctx->outputs.emplace(key, compute()).first;
+  }
+  return it->second;
+}
+
 /**
    Return an approximation of the goodness of a tile to a civilization.
  */
-static int get_tile_value(struct tile *ptile)
+static int get_tile_value(struct tile_value_context *ctx,
+                          struct tile *ptile)
 {
   int value;
   int irrig_bonus = 0;
   int mine_bonus = 0;
-  struct tile *roaded;
+  struct tile *roaded = ctx->scratch;
   struct extra_type *nextra;
+  bv_extras roaded_extras;
 
   /* Give one point for each food / shield / trade produced. */
-  value = 0;
-  output_type_iterate(o)
-  {
-    value += city_tile_output(nullptr, ptile, false,
-                              static_cast<Output_type_id>(o));
-  }
-  output_type_iterate_end;
-
-  roaded = tile_virtual_new(ptile);
+  value = tile_output_sum(ctx, ptile);
+
+  // Reset the scratch tile to a virtual copy of ptile.
+  roaded->index = tile_index(ptile);
+  roaded->extras = ptile->extras;
+  roaded->resource = ptile->resource;
+  roaded->terrain = ptile->terrain;
+  roaded->worked = ptile->worked;
+  roaded->owner = ptile->owner;
+  roaded->extras_owner = ptile->extras_owner;
+  roaded->claimer = ptile->claimer;
 
   if (num_role_units(L_SETTLERS) > 0) {
     struct unit_type *start_worker = get_role_unit(L_SETTLERS, 0);
@@ -78,44 +178,27 @@ static int get_tile_value(struct tile *ptile)
     }
     extra_type_by_cause_iterate_end;
   }
+  roaded_extras = roaded->extras;
 
   nextra = next_extra_for_tile(roaded, EC_IRRIGATION, nullptr, nullptr);
 
   if (nextra != nullptr) {
-    struct tile *vtile;
-
-    vtile = tile_virtual_new(roaded);
-    tile_apply_activity(vtile, ACTIVITY_IRRIGATE, nextra);
-    irrig_bonus = -value;
-    output_type_iterate(o)
-    {
-      irrig_bonus += city_tile_output(nullptr, vtile, false,
-                                      static_cast<Output_type_id>(o));
-    }
-    output_type_iterate_end;
-    tile_virtual_destroy(vtile);
+    tile_apply_activity(roaded, ACTIVITY_IRRIGATE, nextra);
+    irrig_bonus = tile_output_sum(ctx, roaded) - value;
+    roaded->extras = roaded_extras;
+    roaded->resource = ptile->resource;
   }
 
   nextra = next_extra_for_tile(roaded, EC_MINE, nullptr, nullptr);
 
   // Same set of roads used with mine as with irrigation.
   if (nextra != nullptr) {
-    struct tile *vtile;
-
-    vtile = tile_virtual_new(roaded);
-    tile_apply_activity(vtile, ACTIVITY_MINE, nextra);
-    mine_bonus = -value;
-    output_type_iterate(o)
-    {
-      mine_bonus += city_tile_output(nullptr, vtile, false,
-                                     static_cast<Output_type_id>(o));
-    }
-    output_type_iterate_end;
-    tile_virtual_destroy(vtile);
+    tile_apply_activity(roaded, ACTIVITY_MINE, nextra);
+    mine_bonus = tile_output_sum(ctx, roaded) - value;
+    roaded->extras = roaded_extras;
+    roaded->resource = ptile->resource;
   }
 
-  tile_virtual_destroy(roaded);
-
   value += MAX(0, MAX(mine_bonus, irrig_bonus)) / 2;
 
   return value;
@@ -348,11 +431,21 @@ bool create_start_positions(enum map_startpos mode,
   tile_value = new int[MAP_INDEX_SIZE]();
 
   // get the tile value
-  whole_map_iterate(&(wld.map), value_tile)
   {
-    tile_value_aux[tile_index(value_tile)] = get_tile_value(value_tile);
+    struct tile_value_context ctx;
+
+    ctx.scratch = tile_virtual_new(nullptr);
+    ctx.cacheable = tile_outputs_are_local();
+    whole_map_iterate(&(wld.map), value_tile)
+    {
+      tile_value_aux[tile_index(value_tile)] =
+          get_tile_value(&ctx, value_tile);
+    }
+    whole_map_iterate_end;
+    // The scratch tile never owns a city.
+    ctx.scratch->worked = nullptr;
+    tile_virtual_destroy(ctx.scratch);
   }
-  whole_map_iterate_end;
 
   // select the best tiles
   whole_map_iterate(&(wld.map), value_tile)
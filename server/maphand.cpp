@@ -12,9 +12,12 @@
       \____/        ********************************************************/
 
 #include <QBitArray>
+#include <numeric> // std::iota
+#include <vector>
 
 // utility
 #include "bitvector.h"
+#include "capability.h"
 #include "fcintl.h"
 #include "log.h"
 #include "rand.h"
@@ -120,23 +123,24 @@ void nuclear_winter(int effect)
  */
 void climate_change(bool warming, int effect)
 {
-  int k = map_num_tiles();
-  bool used[k];
-  memset(used, 0, sizeof(used));
+  const int k = map_num_tiles();
+  std::vector<int> order(k);
 
   qDebug("Climate change: %s (%d)",
          warming ? "Global warming" : "Nuclear winter", effect);
 
-  while (effect > 0 && (k--) > 0) {
+  /* We want to transform a tile at most once due to a climate change.
+   * Tiles are drawn without replacement from the front of 'order', which
+   * is shuffled lazily. */
+  std::iota(order.begin(), order.end(), 0);
+
+  for (int n = 0; effect > 0 && n < k; n++) {
     struct terrain *old, *candidates[2], *tnew;
     struct tile *ptile;
     int i;
 
-    do {
-      // We want to transform a tile at most once due to a climate change.
-      ptile = rand_map_pos(&(wld.map));
-    } while (used[tile_index(ptile)]);
-    used[tile_index(ptile)] = true;
+    std::swap(order[n], order[n + fc_rand(k - n)]);
+    ptile = index_to_tile(&(wld.map), order[n]);
 
     old = tile_terrain(ptile);
     /* Prefer the transformation that's appropriate to the ambient moisture,
@@ -433,29 +437,25 @@ void give_citymap_from_player_to_player(struct city *pcity,
  */
 void send_all_known_tiles(struct conn_list *dest)
 {
-  int tiles_sent;
-
   if (!dest) {
     dest = game.est_connections;
   }
 
   /* send whole map piece by piece to each player to balance the load
      of the send buffers better */
-  tiles_sent = 0;
   conn_list_do_buffer(dest);
 
-  whole_map_iterate(&(wld.map), ptile)
-  {
-    tiles_sent++;
-    if ((tiles_sent % wld.map.xsize) == 0) {
-      conn_list_do_unbuffer(dest);
-      flush_packets();
-      conn_list_do_buffer(dest);
+  for (int first = 0; first < MAP_INDEX_SIZE; first += wld.map.xsize) {
+    conn_list_iterate(dest, pconn)
+    {
+      send_tile_range(pconn, first, wld.map.xsize);
     }
+    conn_list_iterate_end;
 
-    send_tile_info(dest, ptile, false);
+    conn_list_do_unbuffer(dest);
+    flush_packets();
+    conn_list_do_buffer(dest);
   }
-  whole_map_iterate_end;
 
   conn_list_do_unbuffer(dest);
   flush_packets();
@@ -472,6 +472,117 @@ bool send_tile_suppression(bool now)
   return formerly;
 }
 
+/**
+   Fill in the tile info of ptile as seen by pplayer, or by global observers
+   if pplayer is nullptr. Returns false if pplayer doesn't know the tile, in
+   which case the packet describes an unknown tile.
+ */
+static bool package_tile_info(struct packet_tile_info *info,
+                              const struct tile *ptile,
+                              const struct player *pplayer)
+{
+  const struct player *owner;
+  const struct player *eowner;
+
+  info->tile = tile_index(ptile);
+
+  if (ptile->spec_sprite) {
+    sz_strlcpy(info->spec_sprite, ptile->spec_sprite);
+  } else {
+    info->spec_sprite[0] = '\0';
+  }
+
+  if (!pplayer || map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
+    info->known = TILE_KNOWN_SEEN;
+    info->continent = tile_continent(ptile);
+    owner = tile_owner(ptile);
+    eowner = extra_owner(ptile);
+    info->owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
+    info->extras_owner =
+        (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
+    info->worked = (nullptr != tile_worked(ptile)) ? tile_worked(ptile)->id
+                                                   : IDENTITY_NUMBER_ZERO;
+
+    info->terrain = (nullptr != tile_terrain(ptile))
+                        ? terrain_number(tile_terrain(ptile))
+                        : terrain_count();
+    info->resource = (nullptr != tile_resource(ptile))
+                         ? extra_number(tile_resource(ptile))
+                         : MAX_EXTRA_TYPES;
+    info->placing =
+        (nullptr != ptile->placing) ? extra_number(ptile->placing) : -1;
+    info->place_turn = (nullptr != ptile->placing)
+                           ? game.info.turn + ptile->infra_turns
+                           : 0;
+
+    if (pplayer != nullptr) {
+      info->extras = map_get_player_tile(ptile, pplayer)->extras;
+    } else {
+      info->extras = ptile->extras;
+    }
+
+    if (ptile->label != nullptr) {
+      // Always leave final '\0' in place
+      qstrncpy(info->label, ptile->label, sizeof(info->label) - 1);
+    } else {
+      info->label[0] = '\0';
+    }
+
+    return true;
+  } else if (map_is_known(ptile, pplayer)) {
+    struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+    const vision_site *psite = map_get_player_site(ptile, pplayer);
+
+    info->known = TILE_KNOWN_UNSEEN;
+    info->continent = tile_continent(ptile);
+    owner =
+        (game.server.foggedborders ? plrtile->owner : tile_owner(ptile));
+    eowner = plrtile->extras_owner;
+    info->owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
+    info->extras_owner =
+        (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
+    info->worked =
+        (nullptr != psite) ? psite->identity : IDENTITY_NUMBER_ZERO;
+
+    info->terrain = (nullptr != plrtile->terrain)
+                        ? terrain_number(plrtile->terrain)
+                        : terrain_count();
+    info->resource = (nullptr != plrtile->resource)
+                         ? extra_number(plrtile->resource)
+                         : MAX_EXTRA_TYPES;
+    info->placing = -1;
+    info->place_turn = 0;
+
+    info->extras = plrtile->extras;
+
+    // Labels never change, so they are not subject to fog of war
+    if (ptile->label != nullptr) {
+      sz_strlcpy(info->label, ptile->label);
+    } else {
+      info->label[0] = '\0';
+    }
+
+    return true;
+  } else {
+    info->known = TILE_UNKNOWN;
+    info->continent = 0;
+    info->owner = MAP_TILE_OWNER_NULL;
+    info->extras_owner = MAP_TILE_OWNER_NULL;
+    info->worked = IDENTITY_NUMBER_ZERO;
+
+    info->terrain = terrain_count();
+    info->resource = MAX_EXTRA_TYPES;
+    info->placing = -1;
+    info->place_turn = 0;
+
+    BV_CLR_ALL(info->extras);
+
+    info->label[0] = '\0';
+
+    return false;
+  }
+}
+
 /**
    Send tile information to all the clients in dest which know and see
    the tile. If dest is nullptr, sends to all clients (game.est_connections)
@@ -484,8 +595,6 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown)
 {
   struct packet_tile_info info;
-  const struct player *owner;
-  const struct player *eowner;
 
   if (dest == nullptr) {
     CALL_FUNC_EACH_AI(tile_info, ptile);
@@ -499,14 +608,6 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
     dest = game.est_connections;
   }
 
-  info.tile = tile_index(ptile);
-
-  if (ptile->spec_sprite) {
-    sz_strlcpy(info.spec_sprite, ptile->spec_sprite);
-  } else {
-    info.spec_sprite[0] = '\0';
-  }
-
   conn_list_iterate(dest, pconn)
   {
     struct player *pplayer = pconn->playing;
@@ -515,98 +616,67 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
       continue;
     }
 
-    if (!pplayer || map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
-      info.known = TILE_KNOWN_SEEN;
-      info.continent = tile_continent(ptile);
-      owner = tile_owner(ptile);
-      eowner = extra_owner(ptile);
-      info.owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
-      info.extras_owner =
-          (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
-      info.worked = (nullptr != tile_worked(ptile)) ? tile_worked(ptile)->id
-                                                    : IDENTITY_NUMBER_ZERO;
-
-      info.terrain = (nullptr != tile_terrain(ptile))
-                         ? terrain_number(tile_terrain(ptile))
-                         : terrain_count();
-      info.resource = (nullptr != tile_resource(ptile))
-                          ? extra_number(tile_resource(ptile))
-                          : MAX_EXTRA_TYPES;
-      info.placing =
-          (nullptr != ptile->placing) ? extra_number(ptile->placing) : -1;
-      info.place_turn = (nullptr != ptile->placing)
-                            ? game.info.turn + ptile->infra_turns
-                            : 0;
-
-      if (pplayer != nullptr) {
-        info.extras = map_get_player_tile(ptile, pplayer)->extras;
-      } else {
-        info.extras = ptile->extras;
-      }
-
-      if (ptile->label != nullptr) {
-        // Always leave final '/* Always leave final '\0' in place */' in
-        // place
-        qstrncpy(info.label, ptile->label, sizeof(info.label) - 1);
-      } else {
-        info.label[0] = '\0';
-      }
-
+    if (package_tile_info(&info, ptile, pplayer) || send_unknown) {
       send_packet_tile_info(pconn, &info);
-    } else if (pplayer && map_is_known(ptile, pplayer)) {
-      struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
-      const vision_site *psite = map_get_player_site(ptile, pplayer);
-
-      info.known = TILE_KNOWN_UNSEEN;
-      info.continent = tile_continent(ptile);
-      owner =
-          (game.server.foggedborders ? plrtile->owner : tile_owner(ptile));
-      eowner = plrtile->extras_owner;
-      info.owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
-      info.extras_owner =
-          (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
-      info.worked =
-          (nullptr != psite) ? psite->identity : IDENTITY_NUMBER_ZERO;
-
-      info.terrain = (nullptr != plrtile->terrain)
-                         ? terrain_number(plrtile->terrain)
-                         : terrain_count();
-      info.resource = (nullptr != plrtile->resource)
-                          ? extra_number(plrtile->resource)
-                          : MAX_EXTRA_TYPES;
-      info.placing = -1;
-      info.place_turn = 0;
-
-      info.extras = plrtile->extras;
-
-      // Labels never change, so they are not subject to fog of war
-      if (ptile->label != nullptr) {
-        sz_strlcpy(info.label, ptile->label);
-      } else {
-        info.label[0] = '\0';
-      }
+    }
+  }
+  conn_list_iterate_end;
+}
 
-      send_packet_tile_info(pconn, &info);
-    } else if (send_unknown) {
-      info.known = TILE_UNKNOWN;
-      info.continent = 0;
-      info.owner = MAP_TILE_OWNER_NULL;
-      info.extras_owner = MAP_TILE_OWNER_NULL;
-      info.worked = IDENTITY_NUMBER_ZERO;
+/**
+   Send the tiles with indices from first to first + count - 1 to pconn, if
+   it knows them. This is meant for sending large parts of the map at once:
+   clients with the "tile-snapshot" capability get the tiles in a few
+   PACKET_TILE_SNAPSHOT, which are much smaller than one PACKET_TILE_INFO
+   per tile.
+ */
+void send_tile_range(struct connection *pconn, int first, int count)
+{
+  struct player *pplayer = pconn->playing;
 
-      info.terrain = terrain_count();
-      info.resource = MAX_EXTRA_TYPES;
-      info.placing = -1;
-      info.place_turn = 0;
+  if (send_tile_suppressed || (nullptr == pplayer && !pconn->observer)) {
+    return;
+  }
 
-      BV_CLR_ALL(info.extras);
+  if (!has_capability("tile-snapshot", pconn->capability)) {
+    for (int i = first; i < first + count; i++) {
+      send_tile_info(pconn->self, index_to_tile(&(wld.map), i), false);
+    }
+    return;
+  }
 
-      info.label[0] = '\0';
+  std::vector<packet_tile_info> tiles(count);
+  for (int i = 0; i < count; i++) {
+    package_tile_info(&tiles[i], index_to_tile(&(wld.map), first + i),
+                      pplayer);
+  }
+
+  // Send as many tiles as fit in each packet
+  struct packet_tile_snapshot packet;
+  int sent = 0;
+  while (sent < count) {
+    int chunk = MIN(count - sent, UINT16_MAX);
+    while (!tile_snapshot_encode(&packet, &tiles[sent], chunk)) {
+      fc_assert_ret(chunk > 1);
+      chunk = (chunk + 1) / 2;
+    }
+    send_packet_tile_snapshot(pconn, &packet);
+    sent += chunk;
+  }
 
+  for (const auto &info : tiles) {
+    if (info.known == TILE_UNKNOWN) {
+      continue;
+    }
+    /* What the client was last sent for this tile is not known to the
+     * delta protocol anymore. */
+    pconn->phs.handlers[PACKET_TILE_INFO]->reset(info.tile);
+    if (info.label[0] != '\0' || info.spec_sprite[0] != '\0') {
+      /* Not in the snapshot, which cleared them on the client. Sent in
+       * full thanks to the reset above. */
       send_packet_tile_info(pconn, &info);
     }
   }
-  conn_list_iterate_end;
 }
 
 /**
@@ -1824,8 +1894,8 @@ void bounce_units_on_terrain_change(struct tile *ptile)
 }
 
 /**
-   Returns TRUE if the terrain change from 'oldter' to 'newter' may require
-   expensive reassignment of continents.
+   Returns TRUE if the terrain change from 'oldter' to 'newter' requires
+   continent numbers to be updated.
  */
 bool need_to_reassign_continents(const struct terrain *oldter,
                                  const struct terrain *newter)
@@ -1936,8 +2006,9 @@ void check_terrain_change(struct tile *ptile, struct terrain *oldter)
   }
 
   if (need_to_reassign_continents(oldter, newter)) {
-    assign_continent_numbers();
-    send_all_known_tiles(nullptr);
+    for (auto *ptile2 : update_continent_numbers(ptile)) {
+      send_tile_info(nullptr, ptile2, false);
+    }
   }
 
   claimer = tile_claimer(ptile);
@@ -55,6 +55,7 @@ void give_citymap_from_player_to_player(struct city *pcity,
                                         struct player *pfrom,
                                         struct player *pdest);
 void send_all_known_tiles(struct conn_list *dest);
+void send_tile_range(struct connection *pconn, int first, int count);
 
 bool send_tile_suppression(bool now);
 void send_tile_info(struct conn_list *dest, struct tile *ptile,
@@ -48,6 +48,7 @@
 #include "mood.h"
 #include "notify.h"
 #include "plrhand.h"
+#include "sendqueue.h"
 #include "server_connection.h"
 #include "spacerace.h"
 #include "spaceship.h"
@@ -1053,6 +1054,11 @@ void send_player_info_c(struct player *src, struct conn_list *dest)
     return; // Discard, see comment for player_info_freeze().
   }
 
+  if ((dest == nullptr || dest == game.est_connections)
+      && send_queue_player(src)) {
+    return;
+  }
+
   if (src != nullptr) {
     send_player_info_c_real(src, dest);
     return;
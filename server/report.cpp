@@ -1056,6 +1056,18 @@ static const char *wonders_to_text(int value)
   return value_units(value, PL_(" wonder", " wonders", value));
 }
 
+/**
+   Returns the value of a demographic for pplayer as computed at turn
+   change, or its current value if it is missing (e.g. save).
+ */
+static int cached_demographic(const struct player *pplayer,
+                              const demographic &demo)
+{
+  auto it = pplayer->score.demographics.find(demo.name());
+  return it != pplayer->score.demographics.end() ? it->second
+                                                 : demo.evaluate(pplayer);
+}
+
 /**
    Construct one demographics line.
  */
@@ -1096,7 +1108,8 @@ static void dem_line_item(char *outptr, size_t out_size,
 
     players_iterate(other)
     {
-      if (GOOD_PLAYER(other) && demo.compare(basis, demo.evaluate(other))) {
+      if (GOOD_PLAYER(other)
+          && demo.compare(basis, cached_demographic(other, demo))) {
         place++;
       }
     }
@@ -1112,7 +1125,7 @@ static void dem_line_item(char *outptr, size_t out_size,
     players_iterate(other)
     {
       if (GOOD_PLAYER(other)) {
-        int value = demo.evaluate(other);
+        int value = cached_demographic(other, demo);
         if (!best_player || demo.compare(best_value, value)) {
           best_player = other;
           best_value = value;
@@ -1126,7 +1139,7 @@ static void dem_line_item(char *outptr, size_t out_size,
             && (pplayer != best_player))) {
       cat_snprintf(outptr, out_size, "   %s: %s",
                    nation_plural_for_player(best_player),
-                   demo.text(demo.evaluate(best_player)));
+                   demo.text(cached_demographic(best_player, demo)));
     }
   }
 }
@@ -268,7 +268,12 @@ static struct section_file *openload_ruleset_file(const char *whichset,
   /* Need to save a copy of the filename for following message, since
      section_file_load() may call datafilename() for includes. */
   sfilename = dfilename;
-  secfile = secfile_load(sfilename, false);
+  if (!srvarg.ruleset_cache_pathname.isEmpty()) {
+    secfile =
+        secfile_load_cached(sfilename, false, srvarg.ruleset_cache_pathname);
+  } else {
+    secfile = secfile_load(sfilename, false);
+  }
 
   if (secfile == nullptr) {
     qCCritical(ruleset_category, "Could not load ruleset '%s':\n%s",
@@ -1636,6 +1636,7 @@ static void sg_load_random(struct loaddata *loading)
       }
     }
     fc_rand_set_state(loading->rstate);
+    fc_rand_init_stream_seed();
   } else {
     // No random values - mark the setting.
     (void) secfile_entry_by_path(loading->file, "random.saved");
@@ -5210,8 +5211,7 @@ static void sg_load_sanitycheck(struct loaddata *loading)
     if (loading->version < 30) {
       /* For older savegames we have to recalculate the score with current
        * data, instead of using beginning-of-turn saved scores. */
-      players_iterate(pplayer) { calc_civ_score(pplayer); }
-      players_iterate_end;
+      calc_civ_scores();
     }
   }
 
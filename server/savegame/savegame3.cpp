@@ -2222,6 +2222,18 @@ static void sg_load_random(struct loaddata *loading)
       }
     }
     fc_rand_set_state(loading->rstate);
+
+    bool ok = false;
+    auto stream_seed =
+        QString::fromUtf8(secfile_lookup_str_default(
+                              loading->file, "", "random.stream_seed"))
+            .toULongLong(&ok, 16);
+    if (ok) {
+      fc_rand_set_stream_seed(stream_seed);
+    } else {
+      // Saved before counter-based streams existed.
+      fc_rand_init_stream_seed();
+    }
   } else {
     // No random values - mark the setting.
     (void) secfile_entry_by_path(loading->file, "random.saved");
@@ -2252,6 +2264,10 @@ static void sg_save_random(struct savedata *saving)
 
     secfile_insert_bool(saving->file, true, "random.saved");
     secfile_insert_str(saving->file, state.data(), "random.state");
+    secfile_insert_str(
+        saving->file,
+        qUtf8Printable(QString::number(fc_rand_stream_seed(), 16)),
+        "random.stream_seed");
   } else {
     secfile_insert_bool(saving->file, false, "random.saved");
   }
@@ -252,14 +252,14 @@ static void get_player_landarea(struct claim_map *pcmap,
 }
 
 /**
-   Calculates the civilization score for the player.
+   Calculates the civilization score for the player, using the land areas
+   in pcmap.
  */
-void calc_civ_score(struct player *pplayer)
+static void calc_civ_score(struct player *pplayer, struct claim_map *pcmap)
 {
   const struct research *presearch;
   struct city *wonder_city;
   int landarea = 0, settledarea = 0;
-  static struct claim_map cmap;
 
   pplayer->score.happy = 0;
   pplayer->score.content = 0;
@@ -330,9 +330,7 @@ void calc_civ_score(struct player *pplayer)
   }
   city_list_iterate_end;
 
-  build_landarea_map(&cmap);
-
-  get_player_landarea(&cmap, pplayer, &landarea, &settledarea);
+  get_player_landarea(pcmap, pplayer, &landarea, &settledarea);
   pplayer->score.landarea = landarea;
   pplayer->score.settledarea = settledarea;
 
@@ -370,6 +368,20 @@ void calc_civ_score(struct player *pplayer)
   update_demographics(pplayer);
 }
 
+/**
+   Calculates the civilization score of every player. The land areas of all
+   players are counted in a single pass over the map.
+ */
+void calc_civ_scores()
+{
+  static struct claim_map cmap;
+
+  build_landarea_map(&cmap);
+
+  players_iterate(pplayer) { calc_civ_score(pplayer, &cmap); }
+  players_iterate_end;
+}
+
 /**
    Return the score given by the units stats.
  */
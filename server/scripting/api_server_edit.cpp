@@ -611,8 +611,9 @@ bool api_edit_change_terrain(lua_State *L, Tile *ptile, Terrain *pterr)
   tile_change_terrain(ptile, pterr);
   fix_tile_on_terrain_change(ptile, old_terrain, false);
   if (need_to_reassign_continents(old_terrain, pterr)) {
-    assign_continent_numbers();
-    send_all_known_tiles(nullptr);
+    for (auto *ptile2 : update_continent_numbers(ptile)) {
+      send_tile_info(nullptr, ptile2, false);
+    }
   }
 
   update_tile_knowledge(ptile);
@@ -21,6 +21,7 @@
 #include "api_game_specenum.h"
 #include "luascript.h"
 #include "luascript_func.h"
+#include "luascript_profile.h"
 #include "luascript_signal.h"
 #include "tolua_game_gen.h"
 #include "tolua_signal_gen.h"
@@ -35,12 +36,23 @@
 
 #include "script_server.h"
 
+// Qt
+#include <QByteArray>
+#include <QHash>
+
 /**
    Lua virtual machine states.
  */
 static struct fc_lua *fcl_main = nullptr;
 static struct fc_lua *fcl_unsafe = nullptr;
 
+/**
+   Signal ids, keyed by signal name. Lookups wrap the name passed to
+   script_server_signal_emit() without copying it, which avoids converting
+   it to QString at every emission.
+ */
+static QHash<QByteArray, int> signal_ids;
+
 /**
    Optional game script code (useful for scenarios).
  */
@@ -337,6 +349,7 @@ void script_server_free()
     // luascript_signal_free() is called by luascript_destroy().
     luascript_destroy(fcl_main);
     fcl_main = nullptr;
+    signal_ids.clear();
   }
 
   if (fcl_unsafe != nullptr) {
@@ -373,12 +386,112 @@ void script_server_state_save(struct section_file *file)
 void script_server_signal_emit(const char *signal_name, ...)
 {
   va_list args;
+  int id;
+
+  auto cached = signal_ids.constFind(
+      QByteArray::fromRawData(signal_name, qstrlen(signal_name)));
+  if (cached != signal_ids.constEnd()) {
+    id = *cached;
+  } else {
+    id = luascript_signal_id(fcl_main, signal_name);
+    if (id >= 0) {
+      // Deep copy, the name may not outlive the call
+      signal_ids.insert(QByteArray(signal_name), id);
+    }
+  }
 
   va_start(args, signal_name);
-  luascript_signal_emit_valist(fcl_main, signal_name, args);
+  if (id >= 0) {
+    luascript_signal_emit_id_valist(fcl_main, id, args);
+  } else {
+    // Logs the error
+    luascript_signal_emit_valist(fcl_main, signal_name, args);
+  }
   va_end(args);
 }
 
+/**
+   Returns the number of emissions of every signal that was emitted or has
+   callbacks, and the time spent in their callbacks.
+ */
+QVector<script_signal_stats> script_server_signal_stats()
+{
+  QVector<script_signal_stats> stats;
+
+  fc_assert_ret_val(fcl_main != nullptr, stats);
+
+  for (int i = 0;; i++) {
+    auto psignal = luascript_signal_data_by_index(fcl_main, i);
+    if (psignal == nullptr) {
+      break;
+    }
+    if (psignal->emissions == 0 && psignal->callbacks->isEmpty()) {
+      continue;
+    }
+    stats.append({luascript_signal_by_index(fcl_main, i),
+                  int(psignal->callbacks->size()), psignal->emissions,
+                  psignal->lua_nsecs});
+  }
+
+  return stats;
+}
+
+/**
+   Start profiling the ruleset and scenario scripts.
+ */
+void script_server_profile_start()
+{
+  fc_assert_ret(fcl_main != nullptr);
+  luascript_profile_start(fcl_main);
+}
+
+/**
+   Stop profiling the ruleset and scenario scripts.
+ */
+void script_server_profile_stop() { luascript_profile_stop(fcl_main); }
+
+/**
+   Returns whether the ruleset and scenario scripts are being profiled.
+ */
+bool script_server_profile_running()
+{
+  return luascript_profile_running(fcl_main);
+}
+
+/**
+   Returns the profile of the ruleset and scenario scripts.
+ */
+QVector<luascript_profile_entry> script_server_profile_entries()
+{
+  return luascript_profile_entries(fcl_main);
+}
+
+/**
+   Write the profile of the ruleset and scenario scripts as folded stacks.
+ */
+bool script_server_profile_dump(const QString &filename)
+{
+  return luascript_profile_dump(fcl_main, filename);
+}
+
+/**
+   Warn about signal callbacks running for longer than msecs. 0 disables
+   the warnings.
+ */
+void script_server_set_callback_budget(int msecs)
+{
+  fc_assert_ret(fcl_main != nullptr);
+  fcl_main->callback_budget_ms = msecs;
+}
+
+/**
+   Returns the time budget of signal callbacks, 0 if there is none.
+ */
+int script_server_callback_budget()
+{
+  return fcl_main != nullptr ? fcl_main->callback_budget_ms : 0;
+}
+
 /**
    Declare any new signal types you need here.
  */
@@ -14,8 +14,13 @@
 #include "support.h"
 
 /* common/scriptcore */
+#include "luascript_profile.h"
 #include "luascript_types.h"
 
+// Qt
+#include <QString>
+#include <QVector>
+
 struct section_file;
 struct connection;
 
@@ -41,5 +46,22 @@ void script_server_state_save(struct section_file *file);
 // Signals.
 void script_server_signal_emit(const char *signal_name, ...);
 
+struct script_signal_stats {
+  QString name;
+  int callbacks;
+  unsigned long emissions;
+  qint64 lua_nsecs;
+};
+QVector<script_signal_stats> script_server_signal_stats();
+
+// Profiling.
+void script_server_profile_start();
+void script_server_profile_stop();
+bool script_server_profile_running();
+QVector<luascript_profile_entry> script_server_profile_entries();
+bool script_server_profile_dump(const QString &filename);
+void script_server_set_callback_budget(int msecs);
+int script_server_callback_budget();
+
 // Functions
 bool script_server_call(const char *func_name, ...);
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+/**
+   Deferred sending of city, unit and player info.
+
+   Turn change updates the same cities, units and players many times, and
+   each update used to send them again to every client. Between
+   send_queue_start() and send_queue_processing(), broadcasts are only
+   recorded and each queued object is sent once at the end, with its final
+   state. Info sent to a specific connection list is not delayed.
+ */
+
+// self
+#include "sendqueue.h"
+
+// utility
+#include "log.h"
+
+// common
+#include "city.h"
+#include "connection.h"
+#include "game.h"
+#include "player.h"
+#include "unit.h"
+
+// server
+#include "citytools.h"
+#include "plrhand.h"
+#include "unittools.h"
+
+// Qt
+#include <QString>
+
+// std
+#include <map>
+#include <set>
+
+// Used by send_queue_start() and send_queue_processing().
+static int send_queue_level = 0;
+
+// Cities by id, with whether the info goes to everyone or to the owner.
+static std::map<int, bool> send_queue_cities;
+static std::set<int> send_queue_units;
+static bv_player send_queue_players;
+
+// Number of sends that were queued, for the statistics.
+enum { SQ_CITY, SQ_UNIT, SQ_PLAYER, SQ_COUNT };
+static int send_queue_requests[SQ_COUNT] = {0, 0, 0};
+
+/**
+   Start queuing info. Calls can be nested; the queue is sent when the
+   outermost send_queue_processing() is reached.
+ */
+void send_queue_start()
+{
+  if (send_queue_level++ == 0) {
+    BV_CLR_ALL(send_queue_players);
+    conn_list_do_buffer(game.est_connections);
+  }
+}
+
+/**
+   Send everything that was queued since send_queue_start(), once per
+   object.
+ */
+void send_queue_processing()
+{
+  fc_assert_ret(send_queue_level > 0);
+
+  if (--send_queue_level > 0) {
+    return;
+  }
+
+  int sent[SQ_COUNT] = {0, 0, 0};
+
+  players_iterate(pplayer)
+  {
+    if (BV_ISSET(send_queue_players, player_index(pplayer))) {
+      send_player_info_c(pplayer, nullptr);
+      sent[SQ_PLAYER]++;
+    }
+  }
+  players_iterate_end;
+  BV_CLR_ALL(send_queue_players);
+
+  for (const auto &[id, broadcast] : send_queue_cities) {
+    // The city may have been destroyed in the meantime.
+    if (auto pcity = game_city_by_number(id)) {
+      send_city_info(broadcast ? nullptr : city_owner(pcity), pcity);
+      sent[SQ_CITY]++;
+    }
+  }
+  send_queue_cities.clear();
+
+  for (const int id : send_queue_units) {
+    if (auto punit = game_unit_by_number(id)) {
+      send_unit_info(nullptr, punit);
+      sent[SQ_UNIT]++;
+    }
+  }
+  send_queue_units.clear();
+
+  log_time(QStringLiteral("Deferred sends avoided %1 city, %2 unit and %3 "
+                          "player info updates")
+               .arg(send_queue_requests[SQ_CITY] - sent[SQ_CITY])
+               .arg(send_queue_requests[SQ_UNIT] - sent[SQ_UNIT])
+               .arg(send_queue_requests[SQ_PLAYER] - sent[SQ_PLAYER]));
+  send_queue_requests[SQ_CITY] = 0;
+  send_queue_requests[SQ_UNIT] = 0;
+  send_queue_requests[SQ_PLAYER] = 0;
+
+  conn_list_do_unbuffer(game.est_connections);
+}
+
+/**
+   Queue city info for dest, which is either the owner or nullptr for
+   everyone who can see the city. Returns false if nothing is being
+   queued and the info should be sent right away.
+ */
+bool send_queue_city(struct city *pcity, const struct player *dest)
+{
+  if (send_queue_level == 0
+      || (dest != nullptr && dest != city_owner(pcity))) {
+    return false;
+  }
+
+  send_queue_cities[pcity->id] |= (dest == nullptr);
+  send_queue_requests[SQ_CITY]++;
+  return true;
+}
+
+/**
+   Queue unit info for everyone who can see the unit. Returns false if
+   nothing is being queued and the info should be sent right away.
+ */
+bool send_queue_unit(struct unit *punit)
+{
+  // Moves record who saw the unit while sending.
+  if (send_queue_level == 0 || punit->server.moving != nullptr) {
+    return false;
+  }
+
+  send_queue_units.insert(punit->id);
+  send_queue_requests[SQ_UNIT]++;
+  return true;
+}
+
+/**
+   Queue player info for all connections, or the info of all players if
+   pplayer is nullptr. Returns false if nothing is being queued and the
+   info should be sent right away.
+ */
+bool send_queue_player(struct player *pplayer)
+{
+  if (send_queue_level == 0) {
+    return false;
+  }
+
+  if (pplayer != nullptr) {
+    BV_SET(send_queue_players, player_index(pplayer));
+    send_queue_requests[SQ_PLAYER]++;
+  } else {
+    players_iterate(aplayer)
+    {
+      BV_SET(send_queue_players, player_index(aplayer));
+      send_queue_requests[SQ_PLAYER]++;
+    }
+    players_iterate_end;
+  }
+  return true;
+}
+
+/**
+   Send the queued info of a unit right away. Used before removing it so
+   that clients always know the units they are told to remove.
+ */
+void send_queue_unit_now(struct unit *punit)
+{
+  if (send_queue_units.erase(punit->id) > 0) {
+    // Not nullptr, which would queue it again
+    send_unit_info(game.est_connections, punit);
+  }
+}
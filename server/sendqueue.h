@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+#pragma once
+
+struct city;
+struct player;
+struct unit;
+
+void send_queue_start();
+void send_queue_processing();
+
+bool send_queue_city(struct city *pcity, const struct player *dest);
+bool send_queue_unit(struct unit *punit);
+bool send_queue_player(struct player *pplayer);
+void send_queue_unit_now(struct unit *punit);
@@ -839,7 +839,7 @@ void server::begin_phase()
         struct mapdef *pmapdef = mapimg_isvalid(i);
         if (pmapdef != nullptr) {
           mapimg_create(pmapdef, false, game.server.save_name,
-                        qUtf8Printable(srvarg.saves_pathname));
+                        qUtf8Printable(srvarg.saves_pathname), true);
         } else {
           qCritical("%s", mapimg_error());
         }
@@ -14,15 +14,22 @@
 #include <fc_config.h>
 
 #include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
 // Qt
+#include <QBitArray>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QHash>
+#include <QTimer>
 
 // utility
 #include "bitvector.h"
 #include "bugs.h"
 #include "fcintl.h"
+#include "fcthread.h"
 #include "log.h"
 #include "rand.h"
 #include "support.h"
@@ -76,6 +83,7 @@
 #include "ruleset.h"
 #include "sanitycheck.h"
 #include "score.h"
+#include "sendqueue.h"
 #include "sernet.h"
 #include "server_connection.h"
 #include "server_settings.h"
@@ -154,6 +162,7 @@ void init_game_seed()
     game.server.seed = game.server.seed_setting;
     fc_srand(game.server.seed);
   }
+  fc_rand_init_stream_seed();
 }
 
 /**
@@ -189,8 +198,10 @@ void srv_init()
 
   srvarg.saves_pathname = QStringLiteral("");
   srvarg.scenarios_pathname = QStringLiteral("");
+  srvarg.ruleset_cache_pathname.clear();
 
   srvarg.quitidle = 0;
+  srvarg.mapgen_bench = false;
 
   srvarg.fcdb_enabled = false;
   srvarg.auth_enabled = false;
@@ -591,11 +602,9 @@ bool check_for_game_over()
 }
 
 /**
-   Send all information for when game starts or client reconnects.
-   Initial packets should have been sent before calling this function.
-   See comment in connecthand.c::establish_new_connection().
+   Send the information that must reach the clients before the map.
  */
-void send_all_info(struct conn_list *dest)
+static void send_info_before_map(struct conn_list *dest)
 {
   conn_list_iterate(dest, pconn)
   {
@@ -613,7 +622,13 @@ void send_all_info(struct conn_list *dest)
     }
   };
   send_map_info(dest);
-  send_all_known_tiles(dest);
+}
+
+/**
+   Send the information that is only useful once the map is known.
+ */
+static void send_info_after_map(struct conn_list *dest)
+{
   send_all_known_cities(dest);
   send_all_known_units(dest);
   send_spaceship_info(nullptr, dest);
@@ -622,6 +637,172 @@ void send_all_info(struct conn_list *dest)
   cities_iterate_end;
 }
 
+/**
+   Send all information for when game starts or client reconnects.
+   Initial packets should have been sent before calling this function.
+   See comment in connecthand.c::establish_new_connection().
+ */
+void send_all_info(struct conn_list *dest)
+{
+  send_info_before_map(dest);
+  send_all_known_tiles(dest);
+  send_info_after_map(dest);
+}
+
+/// Time spent sending tiles each time a stream gets to run.
+#define INFO_STREAM_STEP_MSEC 5
+/// Streams wait while this many bytes are not written to the socket yet.
+#define INFO_STREAM_BACKLOG (256 * 1024)
+/// How long a stream waits for its socket to drain.
+#define INFO_STREAM_WAIT_MSEC 20
+
+/**
+   A connection being sent the game state with send_all_info_streamed().
+ */
+struct info_stream {
+  int serial;     // tells restarted streams apart
+  int next_index; // of the next tile to send
+  int bytes_start;
+  QElapsedTimer timer;
+  std::function<void(server_connection *)> done;
+};
+
+// Streams in progress, by connection id.
+static std::map<int, info_stream> info_streams;
+
+static void info_stream_step(int conn_id, int serial, bool finish = false);
+
+/**
+   Schedule the next step of a stream.
+ */
+static void info_stream_schedule(int conn_id, int serial, int msec)
+{
+  QTimer::singleShot(msec, [conn_id, serial] {
+    info_stream_step(conn_id, serial);
+  });
+}
+
+/**
+   Send the next tiles of a stream, and the rest of the game state once the
+   map is complete. With finish, the whole map is sent at once.
+ */
+static void info_stream_step(int conn_id, int serial, bool finish)
+{
+  auto it = info_streams.find(conn_id);
+  if (it == info_streams.end() || it->second.serial != serial) {
+    // Cancelled or restarted
+    return;
+  }
+
+  auto pconn = static_cast<server_connection *>(conn_by_number(conn_id));
+  if (pconn == nullptr || pconn->is_closing
+      || (server_state() != S_S_RUNNING && server_state() != S_S_OVER)) {
+    info_streams.erase(it);
+    return;
+  }
+
+  auto &stream = it->second;
+  if (!finish
+      && pconn->sock->bytesToWrite() + qint64(pconn->send_buffer->ndata)
+             > INFO_STREAM_BACKLOG) {
+    // The client is slower than us, don't pile up data for it
+    info_stream_schedule(conn_id, serial, INFO_STREAM_WAIT_MSEC);
+    return;
+  }
+
+  QElapsedTimer step;
+  step.start();
+  const int map_size = MAP_INDEX_SIZE;
+
+  conn_compression_freeze(pconn);
+  while (stream.next_index < map_size
+         && (finish || step.elapsed() < INFO_STREAM_STEP_MSEC)) {
+    const int count = MIN(wld.map.xsize, map_size - stream.next_index);
+    send_tile_range(pconn, stream.next_index, count);
+    stream.next_index += count;
+  }
+  if (stream.next_index >= map_size) {
+    send_info_after_map(pconn->self);
+  }
+  conn_compression_thaw(pconn);
+  flush_connection_send_buffer_all(pconn);
+
+  if (stream.next_index < map_size) {
+    info_stream_schedule(conn_id, serial, 0);
+    return;
+  }
+
+  // The map is complete
+  auto done = std::move(stream.done);
+  qInfo(_("Sent game state to %s: %d bytes in %lld ms."),
+        conn_description(pconn),
+        pconn->statistics.bytes_send - stream.bytes_start,
+        stream.timer.elapsed());
+  info_streams.erase(it);
+  if (done) {
+    done(pconn);
+  }
+}
+
+/**
+   Send all information to a client joining a running game, like
+   send_all_info(), without blocking the server. The map is sent a few rows
+   at a time from the event loop, interleaved with the processing of the
+   game, and at a pace the connection can follow. Cities and units follow
+   the map, then done is called.
+
+   Tiles that change during the stream reach the client like for other
+   connections, because it is already attached. Tiles it was not sent yet
+   are sent in their state at the time they are reached. Turn and phase
+   changes call finish_info_streams() first, so that they never reach the
+   client before its map.
+ */
+void send_all_info_streamed(server_connection *pconn,
+                            std::function<void(server_connection *)> done)
+{
+  static int serial = 0;
+
+  fc_assert_ret(pconn != nullptr);
+
+  auto &stream = info_streams[pconn->id];
+  stream.serial = ++serial;
+  stream.next_index = 0;
+  stream.bytes_start = pconn->statistics.bytes_send;
+  stream.timer.start();
+  stream.done = std::move(done);
+
+  conn_compression_freeze(pconn);
+  send_info_before_map(pconn->self);
+  conn_compression_thaw(pconn);
+
+  info_stream_step(pconn->id, stream.serial);
+}
+
+/**
+   Stop sending the game state to pconn, if send_all_info_streamed() was
+   still at it.
+ */
+void cancel_info_stream(const server_connection *pconn)
+{
+  info_streams.erase(pconn->id);
+}
+
+/**
+   Send the rest of the game state to every connection that
+   send_all_info_streamed() is still at, without waiting.
+ */
+static void finish_info_streams()
+{
+  // Steps remove their stream from the map
+  std::vector<std::pair<int, int>> pending;
+  for (const auto &[conn_id, stream] : info_streams) {
+    pending.emplace_back(conn_id, stream.serial);
+  }
+  for (const auto &[conn_id, serial] : pending) {
+    info_stream_step(conn_id, serial, true);
+  }
+}
+
 /**
    Give map information to players with EFT_REVEAL_CITIES or
    EFT_REVEAL_MAP effects (traditionally from the Apollo Program).
@@ -1077,6 +1258,8 @@ void begin_turn(bool is_new_turn)
   timer.start();
   log_debug("Begin turn");
 
+  finish_info_streams();
+
   event_cache_remove_old();
 
   // Reset this each turn.
@@ -1116,8 +1299,7 @@ void begin_turn(bool is_new_turn)
     /* We build scores at the beginning of every turn.  We have to
      * build them at the beginning so that the AI can use the data,
      * and we are sure to have it when we need it. */
-    players_iterate(pplayer) { calc_civ_score(pplayer); }
-    players_iterate_end;
+    calc_civ_scores();
     log_civ_score_now();
 
     // Retire useless barbarian units
@@ -1207,6 +1389,8 @@ void begin_phase(bool is_new_phase)
   timer.start();
   log_debug("Begin phase");
 
+  finish_info_streams();
+
   conn_list_do_buffer(game.est_connections);
 
   phase_players_iterate(pplayer)
@@ -1391,6 +1575,8 @@ void end_phase()
   timer.start();
   log_debug("Endphase");
 
+  finish_info_streams();
+
   /*
    * This empties the client Messages window; put this before
    * everything else below, since otherwise any messages from the
@@ -1458,6 +1644,8 @@ void end_phase()
 
   // Freeze sending of cities.
   send_city_suppression(true);
+  // Send everything else once, after the turn change.
+  send_queue_start();
 
   // AI end of turn activities
   players_iterate(pplayer)
@@ -1516,6 +1704,8 @@ void end_phase()
 
   kill_dying_players();
 
+  send_queue_processing();
+
   // Unfreeze sending of cities.
   send_city_suppression(false);
 
@@ -1539,6 +1729,132 @@ void end_phase()
   log_time(QStringLiteral("End phase:%1 milliseconds").arg(timer.elapsed()));
 }
 
+/**
+   Returns the tiles that pass the random check for pextra to spontaneously
+   disappear (if present is set) or appear (otherwise), in map index order.
+
+   The roll of every tile comes from a counter-based random stream keyed by
+   the turn, the extra and the tile, so the result does not depend on the
+   order the tiles are checked in and the map is scanned in parallel.
+ */
+static std::vector<struct tile *>
+spontaneous_extra_candidates(const struct extra_type *pextra, bool present,
+                             int chance)
+{
+  std::vector<std::vector<struct tile *>> rows(wld.map.ysize);
+  std::vector<struct tile *> candidates;
+
+  if (chance <= 0) {
+    return candidates;
+  }
+
+  const fc_rand_stream stream(
+      game.info.turn,
+      present ? RAND_SUB_EXTRA_DISAPPEARANCE : RAND_SUB_EXTRA_APPEARANCE,
+      extra_number(pextra));
+
+  fc_parallel_for(0, wld.map.ysize, [&](int ymin, int ymax) {
+    for (int y = ymin; y < ymax; y++) {
+      for (int x = 0; x < wld.map.xsize; x++) {
+        struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
+
+        if (tile_has_extra(ptile, pextra) == present
+            && stream.at(tile_index(ptile), 10000) < chance) {
+          rows[y].push_back(ptile);
+        }
+      }
+    }
+  });
+
+  for (const auto &row : rows) {
+    candidates.insert(candidates.end(), row.begin(), row.end());
+  }
+
+  return candidates;
+}
+
+/**
+   Handles the spontaneous appearance and disappearance of extras at turn
+   end. Candidates are gathered for each extra type, and the changes are
+   then applied serially. Tile knowledge and unit activities are updated
+   once per changed tile after all extra types are done.
+ */
+static void spontaneous_extras_change()
+{
+  std::vector<struct tile *> changed;
+  QBitArray is_changed(MAP_INDEX_SIZE);
+
+  auto tile_changed = [&](struct tile *ptile) {
+    if (!is_changed.testBit(tile_index(ptile))) {
+      is_changed.setBit(tile_index(ptile));
+      changed.push_back(ptile);
+    }
+  };
+
+  /* Handle disappearing extras before appearing extras ->
+   * Extra never appears only to disappear at the same turn,
+   * but it can disappear and reappear. */
+  extra_type_by_rmcause_iterate(ERM_DISAPPEARANCE, pextra)
+  {
+    for (auto *ptile : spontaneous_extra_candidates(
+             pextra, true, pextra->disappearance_chance)) {
+      if (!tile_has_extra(ptile, pextra)
+          || !can_extra_disappear(pextra, ptile)) {
+        continue;
+      }
+
+      tile_extra_rm_apply(ptile, pextra);
+      tile_changed(ptile);
+
+      if (tile_owner(ptile) != nullptr) {
+        /* TODO: Should notify players nearby even when borders disabled,
+         *       like in case of barbarian uprising */
+        notify_player(tile_owner(ptile), ptile, E_SPONTANEOUS_EXTRA,
+                      ftc_server,
+                      // TRANS: Small Fish disappears from (32, 72).
+                      _("%s disappears from %s."),
+                      extra_name_translation(pextra), tile_link(ptile));
+      }
+    }
+  }
+  extra_type_by_rmcause_iterate_end;
+
+  extra_type_by_cause_iterate(EC_APPEARANCE, pextra)
+  {
+    for (auto *ptile : spontaneous_extra_candidates(
+             pextra, false, pextra->appearance_chance)) {
+      if (tile_has_extra(ptile, pextra)
+          || !can_extra_appear(pextra, ptile)) {
+        continue;
+      }
+
+      tile_extra_apply(ptile, pextra);
+      tile_changed(ptile);
+
+      if (tile_owner(ptile) != nullptr) {
+        /* TODO: Should notify players nearby even when borders disabled,
+         *       like in case of barbarian uprising */
+        notify_player(tile_owner(ptile), ptile, E_SPONTANEOUS_EXTRA,
+                      ftc_server,
+                      // TRANS: Small Fish appears to (32, 72).
+                      _("%s appears to %s."),
+                      extra_name_translation(pextra), tile_link(ptile));
+      }
+    }
+  }
+  extra_type_by_cause_iterate_end;
+
+  conn_list_do_buffer(game.est_connections);
+  for (auto *ptile : changed) {
+    update_tile_knowledge(ptile);
+
+    /* Unit activities at the target tile and its neighbors may now
+     * be illegal because of (!)present reqs. */
+    unit_activities_cancel_all_illegal_area(ptile);
+  }
+  conn_list_do_unbuffer(game.est_connections);
+}
+
 /**
    Handle the end of each turn.
  */
@@ -1548,6 +1864,8 @@ void end_turn()
   timer.start();
   log_debug("Endturn");
 
+  finish_info_streams();
+
   /* Hack: because observer players never get an end-phase packet we send
    * one here. */
   conn_list_iterate(game.est_connections, pconn)
@@ -1677,68 +1995,7 @@ void end_turn()
         nuclear_winter);
   }
 
-  /* Handle disappearing extras before appearing extras ->
-   * Extra never appears only to disappear at the same turn,
-   * but it can disappear and reappear. */
-  extra_type_by_rmcause_iterate(ERM_DISAPPEARANCE, pextra)
-  {
-    whole_map_iterate(&(wld.map), ptile)
-    {
-      if (tile_has_extra(ptile, pextra)
-          && fc_rand(10000) < pextra->disappearance_chance
-          && can_extra_disappear(pextra, ptile)) {
-        tile_extra_rm_apply(ptile, pextra);
-
-        update_tile_knowledge(ptile);
-
-        if (tile_owner(ptile) != nullptr) {
-          /* TODO: Should notify players nearby even when borders disabled,
-           *       like in case of barbarian uprising */
-          notify_player(tile_owner(ptile), ptile, E_SPONTANEOUS_EXTRA,
-                        ftc_server,
-                        // TRANS: Small Fish disappears from (32, 72).
-                        _("%s disappears from %s."),
-                        extra_name_translation(pextra), tile_link(ptile));
-        }
-
-        /* Unit activities at the target tile and its neighbors may now
-         * be illegal because of present reqs. */
-        unit_activities_cancel_all_illegal_area(ptile);
-      }
-    }
-    whole_map_iterate_end;
-  }
-  extra_type_by_rmcause_iterate_end;
-
-  extra_type_by_cause_iterate(EC_APPEARANCE, pextra)
-  {
-    whole_map_iterate(&(wld.map), ptile)
-    {
-      if (!tile_has_extra(ptile, pextra)
-          && fc_rand(10000) < pextra->appearance_chance
-          && can_extra_appear(pextra, ptile)) {
-        tile_extra_apply(ptile, pextra);
-
-        update_tile_knowledge(ptile);
-
-        if (tile_owner(ptile) != nullptr) {
-          /* TODO: Should notify players nearby even when borders disabled,
-           *       like in case of barbarian uprising */
-          notify_player(tile_owner(ptile), ptile, E_SPONTANEOUS_EXTRA,
-                        ftc_server,
-                        // TRANS: Small Fish appears to (32, 72).
-                        _("%s appears to %s."),
-                        extra_name_translation(pextra), tile_link(ptile));
-        }
-
-        /* Unit activities at the target tile and its neighbors may now
-         * be illegal because of !present reqs. */
-        unit_activities_cancel_all_illegal_area(ptile);
-      }
-    }
-    whole_map_iterate_end;
-  }
-  extra_type_by_cause_iterate_end;
+  spontaneous_extras_change();
 
   update_diplomatics();
   make_history_report();
@@ -2794,8 +3051,7 @@ static void announce_player(struct player *pplayer)
 void srv_scores()
 {
   // Recalculate the scores in case of a spaceship victory
-  players_iterate(pplayer) { calc_civ_score(pplayer); }
-  players_iterate_end;
+  calc_civ_scores();
 
   log_civ_score_now();
 
@@ -22,6 +22,9 @@
 // Qt
 #include <QHostAddress>
 
+// std
+#include <functional>
+
 struct conn_list;
 struct server_connection;
 
@@ -49,12 +52,14 @@ struct server_arguments {
   QString saves_pathname;
   QString scenarios_pathname;
   QString ruleset;
+  QString ruleset_cache_pathname; // empty => rulesets are always parsed
   QString serverid;
   // quit if there no players after a given time interval
   int quitidle;
   // exit the server on game ending
   bool exit_on_end;
-  bool timetrack; // defaults to FALSE
+  bool timetrack;    // defaults to FALSE
+  bool mapgen_bench; // defaults to FALSE
   // authentication options
   bool fcdb_enabled;        // defaults to FALSE
   QString fcdb_conf;        // freeciv database configuration file
@@ -118,6 +123,9 @@ const char *pick_random_player_name(const struct nation_type *pnation);
 void player_nation_defaults(struct player *pplayer,
                             struct nation_type *pnation, bool set_name);
 void send_all_info(struct conn_list *dest);
+void send_all_info_streamed(server_connection *pconn,
+                            std::function<void(server_connection *)> done);
+void cancel_info_stream(const server_connection *pconn);
 
 void begin_turn(bool is_new_turn);
 void begin_phase(bool is_new_phase);
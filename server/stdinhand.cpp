@@ -76,6 +76,7 @@
 
 // Qt
 #include <QCoreApplication>
+#include <QHash>
 #include <QRegularExpression>
 
 // std
@@ -4983,6 +4984,10 @@ static bool default_command(server_connection *caller, char *arg, bool check)
 #define SPECENUM_VALUE2NAME "unsafe-cmd"
 #define SPECENUM_VALUE3 LUA_UNSAFE_FILE
 #define SPECENUM_VALUE3NAME "unsafe-file"
+#define SPECENUM_VALUE4 LUA_SIGNALS
+#define SPECENUM_VALUE4NAME "signals"
+#define SPECENUM_VALUE5 LUA_PROFILE
+#define SPECENUM_VALUE5NAME "profile"
 #include "specenum_gen.h"
 
 /**
@@ -4994,6 +4999,116 @@ static const char *lua_accessor(int i)
   return lua_args_name(static_cast<enum lua_args>(i));
 }
 
+/**
+   Show how often every Lua signal was emitted and how much time was spent
+   in its callbacks.
+ */
+static void show_lua_signal_stats(server_connection *caller)
+{
+  cmd_reply(CMD_LUA, caller, C_COMMENT, _("Lua signals:"));
+  cmd_reply(CMD_LUA, caller, C_COMMENT, horiz_line);
+  cmd_reply(CMD_LUA, caller, C_COMMENT, "%-32s %9s %10s %9s",
+            _("Signal"), _("Callbacks"), _("Emitted"), _("Time"));
+  for (const auto &stats : script_server_signal_stats()) {
+    cmd_reply(CMD_LUA, caller, C_COMMENT, "%-32s %9d %10lu %7.1fms",
+              qUtf8Printable(stats.name), stats.callbacks, stats.emissions,
+              stats.lua_nsecs / 1e6);
+  }
+  cmd_reply(CMD_LUA, caller, C_COMMENT, horiz_line);
+}
+
+/**
+   Control the Lua profiler: "start", "stop", "report", "dump <file>" or
+   "budget <ms>".
+ */
+static bool lua_profile_command(server_connection *caller,
+                                const char *arg, bool check,
+                                int read_recursion)
+{
+  const auto tokens =
+      QString(arg).split(QRegularExpression(REG_EXP), Qt::SkipEmptyParts);
+  const auto action = tokens.isEmpty() ? QString() : tokens.at(0);
+  bool ok = true;
+  int budget = 0;
+
+  if (action == QLatin1String("dump")) {
+    if (tokens.size() != 2) {
+      cmd_reply(CMD_LUA, caller, C_SYNTAX,
+                _("Usage: lua profile dump <file>"));
+      return false;
+    } else if (read_recursion > 0 || is_restricted(caller)) {
+      cmd_reply(CMD_LUA, caller, C_FAIL,
+                _("You aren't allowed to write files."));
+      return false;
+    }
+  } else if (action == QLatin1String("budget")) {
+    if (tokens.size() == 2) {
+      budget = tokens.at(1).toInt(&ok);
+    }
+    if (tokens.size() != 2 || !ok || budget < 0) {
+      cmd_reply(CMD_LUA, caller, C_SYNTAX,
+                _("Usage: lua profile budget <milliseconds>"));
+      return false;
+    }
+  } else if (action != QLatin1String("start")
+             && action != QLatin1String("stop")
+             && action != QLatin1String("report")) {
+    cmd_reply(CMD_LUA, caller, C_SYNTAX,
+              _("Usage: lua profile start|stop|report|dump <file>|"
+                "budget <milliseconds>"));
+    return false;
+  }
+
+  if (check) {
+    return true;
+  }
+
+  if (action == QLatin1String("start")) {
+    script_server_profile_start();
+    cmd_reply(CMD_LUA, caller, C_OK, _("Lua profiler started."));
+  } else if (action == QLatin1String("stop")) {
+    script_server_profile_stop();
+    cmd_reply(CMD_LUA, caller, C_OK, _("Lua profiler stopped."));
+  } else if (action == QLatin1String("report")) {
+    const auto entries = script_server_profile_entries();
+    cmd_reply(CMD_LUA, caller, C_COMMENT, _("Lua profile:"));
+    cmd_reply(CMD_LUA, caller, C_COMMENT, horiz_line);
+    cmd_reply(CMD_LUA, caller, C_COMMENT, "%-40s %8s %9s %9s %10s",
+              _("Function"), _("Calls"), _("Total"), _("Self"),
+              _("Instr."));
+    for (int i = 0; i < entries.size() && i < 20; i++) {
+      const auto &entry = entries.at(i);
+      cmd_reply(CMD_LUA, caller, C_COMMENT,
+                "%-40s %8lu %7.1fms %7.1fms %10lld",
+                qUtf8Printable(entry.name), entry.calls,
+                entry.total_nsecs / 1e6, entry.self_nsecs / 1e6,
+                entry.instructions);
+    }
+    cmd_reply(CMD_LUA, caller, C_COMMENT, horiz_line);
+  } else if (action == QLatin1String("dump")) {
+    const auto filename = interpret_tilde(tokens.at(1));
+    if (!script_server_profile_dump(filename)) {
+      cmd_reply(CMD_LUA, caller, C_FAIL, _("Cannot write '%s'."),
+                qUtf8Printable(filename));
+      return false;
+    }
+    cmd_reply(CMD_LUA, caller, C_OK, _("Lua profile written to '%s'."),
+              qUtf8Printable(filename));
+  } else if (action == QLatin1String("budget")) {
+    script_server_set_callback_budget(budget);
+    if (budget > 0) {
+      cmd_reply(CMD_LUA, caller, C_OK,
+                _("Warning about Lua callbacks taking more than %d ms."),
+                budget);
+    } else {
+      cmd_reply(CMD_LUA, caller, C_OK,
+                _("Lua callback time budget disabled."));
+    }
+  }
+
+  return true;
+}
+
 /**
    Evaluate a line of lua script or a lua script file.
  */
@@ -5050,8 +5165,13 @@ static bool lua_command(server_connection *caller, char *arg, bool check,
     return true;
   }
 
+  if (ind == LUA_PROFILE) {
+    return lua_profile_command(caller, luaarg, check, read_recursion);
+  }
+
   switch (ind) {
   case LUA_CMD:
+  case LUA_SIGNALS:
     // Nothing to check.
     break;
   case LUA_UNSAFE_CMD:
@@ -5119,6 +5239,10 @@ static bool lua_command(server_connection *caller, char *arg, bool check,
   case LUA_CMD:
     ret = script_server_do_string(caller, luaarg);
     break;
+  case LUA_SIGNALS:
+    show_lua_signal_stats(caller);
+    ret = true;
+    break;
   case LUA_UNSAFE_CMD:
     ret = script_server_unsafe_do_string(caller, luaarg);
     break;
@@ -5881,7 +6005,8 @@ static bool mapimg_command(server_connection *caller, char *arg, bool check)
 
         if (pmapdef == nullptr
             || !mapimg_create(pmapdef, true, game.server.save_name,
-                              qUtf8Printable(srvarg.saves_pathname))) {
+                              qUtf8Printable(srvarg.saves_pathname),
+                              false)) {
           cmd_reply(CMD_MAPIMG, caller, C_FAIL,
                     _("Error saving map image %d: %s."), id, mapimg_error());
           ret = false;
@@ -5898,7 +6023,7 @@ static bool mapimg_command(server_connection *caller, char *arg, bool check)
       pmapdef = mapimg_isvalid(id);
       if (pmapdef == nullptr
           || !mapimg_create(pmapdef, true, game.server.save_name,
-                            qUtf8Printable(srvarg.saves_pathname))) {
+                            qUtf8Printable(srvarg.saves_pathname), false)) {
         cmd_reply(CMD_MAPIMG, caller, C_FAIL,
                   _("Error saving map image %d: %s."), id, mapimg_error());
         ret = false;
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "support.h" // sz_strlcpy
+
+// common
+#include "actions.h"
+#include "fc_interface.h"
+#include "game.h"
+#include "map.h"
+#include "nation.h"
+#include "player.h"
+#include "research.h"
+#include "unit.h"
+#include "unittype.h"
+
+// server
+#include "aiiface.h"
+#include "maphand.h"
+#include "plrhand.h"
+#include "ruleset.h"
+#include "sernet.h"
+#include "settings.h"
+#include "srv_main.h"
+#include "techtools.h"
+#include "unittools.h"
+
+// Qt
+#include <QVector>
+#include <QtTest>
+
+// std
+#include <utility> // std::as_const
+
+/**
+ * Compares the batch action probabilities with the single target ones
+ */
+class test_actions : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void units();
+  void tiles();
+  void target_unit();
+
+private:
+  QVector<struct unit *> actors;
+  QVector<const struct unit *> targets;
+  QVector<const struct tile *> tiles_around;
+};
+
+namespace {
+/**
+ * Creates a player ready to own units
+ */
+struct player *create_player()
+{
+  auto pnation = pick_a_nation(nullptr, false, false, NOT_A_BARBARIAN);
+  auto pplayer =
+      server_create_player(-1, default_ai_type_name(), nullptr, false);
+  server_player_init(pplayer, true, true);
+
+  player_set_nation(pplayer, pnation);
+  player_nation_defaults(pplayer, pnation, true);
+  pplayer->government = init_government_of_nation(pnation);
+  init_tech(research_get(pplayer), true);
+
+  return pplayer;
+}
+
+/**
+ * Creates a unit of the given type
+ */
+struct unit *create(struct player *pplayer, struct tile *ptile,
+                    const char *type)
+{
+  auto utype = unit_type_by_rule_name(type);
+  fc_assert_ret_val(utype != nullptr, nullptr);
+  return create_unit(pplayer, ptile, utype, 0, 0, -1);
+}
+} // anonymous namespace
+
+/**
+ * Loads a ruleset and sets up a small world with units next to each other
+ */
+void test_actions::initTestCase()
+{
+  srv_init();
+  init_connections();
+
+  struct functions *funcs = fc_interface_funcs();
+  funcs->server_setting_by_name = server_ss_by_name;
+  funcs->server_setting_name_get = server_ss_name_get;
+  funcs->server_setting_type_get = server_ss_type_get;
+  funcs->server_setting_val_bool_get = server_ss_val_bool_get;
+  funcs->server_setting_val_int_get = server_ss_val_int_get;
+  funcs->server_setting_val_bitwise_get = server_ss_val_bitwise_get;
+  funcs->create_extra = create_extra;
+  funcs->destroy_extra = destroy_extra;
+  funcs->player_tile_vision_get = map_is_known_and_seen;
+  funcs->player_tile_city_id_get = server_plr_tile_city_id_get;
+  fc_interface_init();
+
+  settings_init(true);
+  server_game_init(false);
+  game.info.aifill = 0;
+  sz_strlcpy(game.server.rulesetdir, "civ2civ3");
+  QVERIFY(load_rulesets(nullptr, nullptr, false, nullptr, true, false,
+                        true));
+
+  // A map of grassland
+  wld.map.xsize = MAP_MIN_LINEAR_SIZE;
+  wld.map.ysize = MAP_MIN_LINEAR_SIZE;
+  map_init_topology();
+  main_map_allocate();
+  auto grassland = terrain_by_rule_name("Grassland");
+  QVERIFY(grassland != nullptr);
+  whole_map_iterate(&(wld.map), ptile)
+  {
+    tile_set_terrain(ptile, grassland);
+  }
+  whole_map_iterate_end;
+
+  auto us = create_player();
+  auto them = create_player();
+  player_diplstate_get(us, them)->type = DS_WAR;
+  player_diplstate_get(them, us)->type = DS_WAR;
+
+  // Actors in the middle of the map
+  auto center = native_pos_to_tile(&(wld.map), wld.map.xsize / 2,
+                                   wld.map.ysize / 2);
+  for (const auto type : {"Diplomat", "Spy", "Warriors", "Explorer"}) {
+    auto actor = create(us, center, type);
+    QVERIFY(actor != nullptr);
+    actors.append(actor);
+  }
+
+  // Targets around them: alone, stacked, ours and out of reach
+  QVector<struct tile *> around;
+  adjc_iterate(&(wld.map), center, ptile)
+  {
+    around.append(ptile);
+    tiles_around.append(ptile);
+  }
+  adjc_iterate_end;
+  QVERIFY(around.size() >= 3);
+
+  targets.append(create(them, around[0], "Warriors"));
+  targets.append(create(them, around[1], "Warriors"));
+  targets.append(create(them, around[1], "Explorer"));
+  targets.append(create(us, around[2], "Warriors"));
+  whole_map_iterate(&(wld.map), ptile)
+  {
+    if (real_map_distance(center, ptile) == 3) {
+      targets.append(create(them, ptile, "Warriors"));
+      break;
+    }
+  }
+  whole_map_iterate_end;
+  QVERIFY(!targets.contains(nullptr));
+
+  // The world is set up such that some actions are possible
+  QVERIFY(action_prob_possible(
+      action_prob_vs_unit(actors[0], ACTION_SPY_BRIBE_UNIT, targets[0])));
+}
+
+/**
+ * Batch probabilities against units equal the single target ones
+ */
+void test_actions::units()
+{
+  action_iterate(act)
+  {
+    if (action_id_get_actor_kind(act) != AAK_UNIT
+        || action_id_get_target_kind(act) != ATK_UNIT) {
+      continue;
+    }
+
+    for (const auto actor : std::as_const(actors)) {
+      const auto probs = action_probs_vs_unit(actor, act, targets);
+      QCOMPARE(probs.size(), targets.size());
+      for (int i = 0; i < targets.size(); i++) {
+        const auto single = action_prob_vs_unit(actor, act, targets[i]);
+        QVERIFY2(are_action_probabilitys_equal(&probs[i], &single),
+                 qPrintable(QStringLiteral("%1 by %2 against target %3")
+                                .arg(action_id_rule_name(act))
+                                .arg(unit_rule_name(actor))
+                                .arg(i)));
+      }
+    }
+  }
+  action_iterate_end;
+
+  // No actor
+  const auto probs =
+      action_probs_vs_unit(nullptr, ACTION_SPY_BRIBE_UNIT, targets);
+  QCOMPARE(probs.size(), targets.size());
+  for (const auto &prob : probs) {
+    QVERIFY(!action_prob_possible(prob));
+  }
+}
+
+/**
+ * Batch probabilities against tiles equal the single target ones
+ */
+void test_actions::tiles()
+{
+  action_iterate(act)
+  {
+    if (action_id_get_actor_kind(act) != AAK_UNIT
+        || action_id_get_target_kind(act) != ATK_TILE) {
+      continue;
+    }
+
+    for (const auto actor : std::as_const(actors)) {
+      const auto probs =
+          action_probs_vs_tile(actor, act, tiles_around, nullptr);
+      QCOMPARE(probs.size(), tiles_around.size());
+      for (int i = 0; i < tiles_around.size(); i++) {
+        const auto single =
+            action_prob_vs_tile(actor, act, tiles_around[i], nullptr);
+        QVERIFY2(are_action_probabilitys_equal(&probs[i], &single),
+                 qPrintable(QStringLiteral("%1 by %2 against tile %3")
+                                .arg(action_id_rule_name(act))
+                                .arg(unit_rule_name(actor))
+                                .arg(i)));
+      }
+    }
+  }
+  action_iterate_end;
+}
+
+/**
+ * The target unit is the first one any action is possible against
+ */
+void test_actions::target_unit()
+{
+  for (const auto actor : std::as_const(actors)) {
+    for (const auto target : std::as_const(targets)) {
+      auto ptile = unit_tile(target);
+
+      for (const bool accept_all : {false, true}) {
+        struct unit *expected = nullptr;
+        unit_list_iterate(ptile->units, candidate)
+        {
+          action_iterate(act)
+          {
+            if (action_id_get_actor_kind(act) == AAK_UNIT
+                && action_id_get_target_kind(act) == ATK_UNIT
+                && (accept_all || !action_id_is_rare_pop_up(act))
+                && action_prob_possible(
+                    action_prob_vs_unit(actor, act, candidate))) {
+              expected = candidate;
+              break;
+            }
+          }
+          action_iterate_end;
+
+          if (expected != nullptr) {
+            break;
+          }
+        }
+        unit_list_iterate_end;
+
+        QCOMPARE(action_tgt_unit(actor, ptile, accept_all), expected);
+      }
+    }
+  }
+}
+
+QTEST_GUILESS_MAIN(test_actions)
+#include "actions.moc"
@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <set>
 
 // utility
 #include "bitvector.h"
@@ -64,6 +65,7 @@
 #include "maphand.h"
 #include "notify.h"
 #include "plrhand.h"
+#include "sendqueue.h"
 #include "sernet.h"
 #include "srv_main.h"
 #include "techtools.h"
@@ -2037,6 +2039,9 @@ static void server_remove_unit_full(struct unit *punit, bool transported,
   // The unit is doomed.
   punit->server.dying = true;
 
+  // Clients must know the unit before they are told to remove it.
+  send_queue_unit_now(punit);
+
 #ifdef FREECIV_DEBUG
   unit_list_iterate(ptile->units, pcargo)
   {
@@ -2995,6 +3000,9 @@ void send_unit_info(struct conn_list *dest, struct unit *punit)
   struct unit_move_data *pdata;
 
   if (dest == nullptr) {
+    if (send_queue_unit(punit)) {
+      return;
+    }
     dest = game.est_connections;
   }
 
@@ -3795,18 +3803,39 @@ static void wakeup_neighbor_sentries(struct unit *punit)
   square_iterate_end;
 }
 
+/**
+   Refresh a city after a unit moved, and send it to its owner. When
+   deferred isn't nullptr, only remember the city so that it gets refreshed
+   once after the whole group of units has moved.
+ */
+static void unit_move_refresh_city(struct city *pcity,
+                                   struct player *pplayer,
+                                   std::set<int> *deferred)
+{
+  if (deferred != nullptr) {
+    deferred->insert(pcity->id);
+  } else {
+    city_refresh(pcity);
+    send_city_info(pplayer, pcity);
+  }
+}
+
 /**
    Does: 1) updates the unit's homecity and the city it enters/leaves (the
             city's happiness varies). This also takes into account when the
             unit enters/leaves a fortress.
          2) updates adjacent cities' unavailable tiles.
 
+   When deferred isn't nullptr, the cities are not refreshed but added to
+   it, and the caller is responsible for 2).
+
    FIXME: Sometimes it is not necessary to send cities because the goverment
           doesn't care whether a unit is away or not.
  */
 static bool unit_move_consequences(struct unit *punit, struct tile *src_tile,
                                    struct tile *dst_tile, bool passenger,
-                                   bool conquer_city_allowed)
+                                   bool conquer_city_allowed,
+                                   std::set<int> *deferred = nullptr)
 {
   struct city *fromcity = tile_city(src_tile);
   struct city *tocity = tile_city(dst_tile);
@@ -3861,8 +3890,7 @@ static bool unit_move_consequences(struct unit *punit, struct tile *src_tile,
   if (tocity) { // entering a city
     if (tocity->owner == pplayer_end_pos) {
       if (tocity != homecity_end_pos && is_human(pplayer_end_pos)) {
-        city_refresh(tocity);
-        send_city_info(pplayer_end_pos, tocity);
+        unit_move_refresh_city(tocity, pplayer_end_pos, deferred);
       }
     }
     if (homecity_start_pos) {
@@ -3877,8 +3905,7 @@ static bool unit_move_consequences(struct unit *punit, struct tile *src_tile,
     if (fromcity != homecity_start_pos
         && fromcity->owner == pplayer_start_pos
         && is_human(pplayer_start_pos)) {
-      city_refresh(fromcity);
-      send_city_info(pplayer_start_pos, fromcity);
+      unit_move_refresh_city(fromcity, pplayer_start_pos, deferred);
     }
   }
 
@@ -3898,19 +3925,19 @@ static bool unit_move_consequences(struct unit *punit, struct tile *src_tile,
   }
 
   if (refresh_homecity_start_pos && is_human(pplayer_start_pos)) {
-    city_refresh(homecity_start_pos);
-    send_city_info(pplayer_start_pos, homecity_start_pos);
+    unit_move_refresh_city(homecity_start_pos, pplayer_start_pos, deferred);
   }
   if (refresh_homecity_end_pos
       && (!refresh_homecity_start_pos
           || homecity_start_pos != homecity_end_pos)
       && is_human(pplayer_end_pos)) {
-    city_refresh(homecity_end_pos);
-    send_city_info(pplayer_end_pos, homecity_end_pos);
+    unit_move_refresh_city(homecity_end_pos, pplayer_end_pos, deferred);
   }
 
-  city_map_update_tile_now(dst_tile);
-  sync_cities();
+  if (deferred == nullptr) {
+    city_map_update_tile_now(dst_tile);
+    sync_cities();
+  }
 
   return alive;
 }
@@ -4306,19 +4333,39 @@ bool unit_move(struct unit *punit, struct tile *pdesttile, int move_cost,
   }
   unit_move_data_list_iterate_end;
 
-  // Move consequences.
-  unit_move_data_list_iterate(plist, pmove_data)
-  {
-    struct unit *aunit = pmove_data->punit;
+  /* Move consequences. A transporter and its cargo affect the same
+   * cities, which are refreshed once when all the units are done. */
+  if (unit_move_data_list_size(plist) > 1) {
+    std::set<int> refresh_cities;
+
+    unit_move_data_list_iterate(plist, pmove_data)
+    {
+      struct unit *aunit = pmove_data->punit;
 
-    if (aunit != nullptr && unit_owner(aunit) == pmove_data->powner
-        && unit_tile(aunit) == pdesttile) {
-      (void) unit_move_consequences(aunit, psrctile, pdesttile,
-                                    pdata != pmove_data,
-                                    conquer_city_allowed);
+      if (aunit != nullptr && unit_owner(aunit) == pmove_data->powner
+          && unit_tile(aunit) == pdesttile) {
+        (void) unit_move_consequences(aunit, psrctile, pdesttile,
+                                      pdata != pmove_data,
+                                      conquer_city_allowed, &refresh_cities);
+      }
+    }
+    unit_move_data_list_iterate_end;
+
+    for (int city_id : refresh_cities) {
+      // Lua scripts run by a conquest may have destroyed the city.
+      if (struct city *acity = game_city_by_number(city_id)) {
+        city_refresh(acity);
+        send_city_info(city_owner(acity), acity);
+      }
     }
+    city_map_update_tile_now(pdesttile);
+    sync_cities();
+  } else if (pdata->punit != nullptr
+             && unit_owner(pdata->punit) == pdata->powner
+             && unit_tile(pdata->punit) == pdesttile) {
+    (void) unit_move_consequences(pdata->punit, psrctile, pdesttile, false,
+                                  conquer_city_allowed);
   }
-  unit_move_data_list_iterate_end;
 
   unit_lives = (pdata->punit == punit);
 
@@ -6,6 +6,11 @@
 
 // Qt
 #include <QMutexLocker>
+#include <QSemaphore>
+#include <QThreadPool>
+
+// std
+#include <algorithm> // std::min
 
 fcThread::fcThread(void(tfunc)(void *), void *tdata)
     : func(tfunc), data(tdata)
@@ -27,3 +32,48 @@ void fcThread::run()
     (func)(data);
   }
 }
+
+/**
+   Runs func over the half-open range [begin, end), split in contiguous
+   chunks of at least grain elements that are processed concurrently on
+   the global thread pool. func is called as func(chunk_begin, chunk_end)
+   and must only write to data owned by its chunk.
+
+   The calling thread processes the first chunk itself. Chunks that cannot
+   be handed to an idle pool thread are run inline as well, so this never
+   blocks waiting for a busy pool and can safely be nested.
+ */
+void fc_parallel_for(int begin, int end,
+                     const std::function<void(int, int)> &func, int grain)
+{
+  const int count = end - begin;
+  if (count <= 0) {
+    return;
+  }
+
+  auto pool = QThreadPool::globalInstance();
+  const int chunks =
+      std::min(pool->maxThreadCount(), count / std::max(1, grain));
+  if (chunks <= 1) {
+    func(begin, end);
+    return;
+  }
+
+  QSemaphore done;
+  int started = 0;
+  for (int i = 1; i < chunks; i++) {
+    const int chunk_begin = begin + count * i / chunks;
+    const int chunk_end = begin + count * (i + 1) / chunks;
+
+    if (pool->tryStart([&func, &done, chunk_begin, chunk_end] {
+          func(chunk_begin, chunk_end);
+          done.release();
+        })) {
+      started++;
+    } else {
+      func(chunk_begin, chunk_end);
+    }
+  }
+  func(begin, begin + count / chunks);
+  done.acquire(started);
+}
@@ -8,6 +8,9 @@
 #include <QThread>
 #include <qcompilerdetection.h> // Q_DECL_OVERRIDE
 
+// std
+#include <functional>
+
 class fcThread : public QThread {
 public:
   fcThread() = default;
@@ -24,3 +27,7 @@ class fcThread : public QThread {
   void *data = nullptr;
   QMutex mutex;
 };
+
+void fc_parallel_for(int begin, int end,
+                     const std::function<void(int, int)> &func,
+                     int grain = 1);
@@ -25,6 +25,8 @@
  * See also the speclist module.
  */
 
+#include <fc_config.h>
+
 // self
 #include "genlist.h"
 
@@ -36,8 +38,124 @@
 #include <algorithm> // std::shuffle
 #include <cstddef>   // size_t
 #include <cstdlib>   // qsort
+#include <mutex>     // std::mutex
 #include <vector>    // std::vector
 
+#ifdef FREECIV_GENLIST_POOL
+namespace {
+/// Number of links allocated at once when a thread runs out of them.
+constexpr int LINK_CHUNK_SIZE = 256;
+
+/**
+ * A block of links. Blocks are never released and are chained together so
+ * that they remain reachable for leak checkers.
+ */
+struct link_chunk {
+  link_chunk *next;
+  genlist_link links[LINK_CHUNK_SIZE];
+};
+link_chunk *all_chunks = nullptr;
+
+/**
+ * Links released by threads that have exited, chained through their next
+ * pointer. Taken back by the first thread running out of links.
+ */
+genlist_link *orphan_links = nullptr;
+std::mutex pool_mutex;
+
+/**
+ * Free links of the current thread, chained through their next pointer.
+ * Most lists are created, filled and emptied by a single thread, so
+ * keeping the free list per thread avoids any locking on the hot path.
+ */
+thread_local genlist_link *free_links = nullptr;
+
+/**
+ * Hands the free links of an exiting thread over to the other threads.
+ */
+struct link_pool_reclaimer {
+  ~link_pool_reclaimer()
+  {
+    if (free_links == nullptr) {
+      return;
+    }
+
+    auto last = free_links;
+    while (last->next != nullptr) {
+      last = last->next;
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    last->next = orphan_links;
+    orphan_links = free_links;
+    free_links = nullptr;
+  }
+};
+thread_local link_pool_reclaimer reclaimer;
+
+/**
+ * Refills the free list of the current thread, either from the links left
+ * by exited threads or with a new chunk. A chunk is threaded in address
+ * order so that lists built in one go end up mostly contiguous in memory.
+ */
+void link_pool_refill()
+{
+  // The thread now owns links: hand them over when it exits
+  (void) &reclaimer;
+
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (orphan_links != nullptr) {
+    free_links = orphan_links;
+    orphan_links = nullptr;
+    return;
+  }
+
+  auto chunk = new link_chunk;
+  chunk->next = all_chunks;
+  all_chunks = chunk;
+  for (int i = LINK_CHUNK_SIZE - 1; i >= 0; i--) {
+    chunk->links[i].next = free_links;
+    free_links = &chunk->links[i];
+  }
+}
+} // anonymous namespace
+#endif // FREECIV_GENLIST_POOL
+
+/**
+   Allocate an uninitialized link.
+ */
+static inline struct genlist_link *link_alloc()
+{
+#ifdef FREECIV_GENLIST_POOL
+  if (free_links == nullptr) {
+    link_pool_refill();
+  }
+  auto plink = free_links;
+  free_links = plink->next;
+  return plink;
+#else
+  return new genlist_link;
+#endif
+}
+
+/**
+   Release a link allocated with link_alloc().
+ */
+static inline void link_free(struct genlist_link *plink)
+{
+#ifdef FREECIV_GENLIST_POOL
+  if (free_links == nullptr) {
+    // Make sure the links are handed over when the thread exits
+    (void) &reclaimer;
+  }
+  // LIFO, so that the most recently released (cache-hot) link is reused
+  plink->next = free_links;
+  free_links = plink;
+#else
+  delete plink;
+#endif
+}
+
 /**
    Create a new empty genlist.
  */
@@ -78,7 +196,7 @@ static void genlist_link_new(struct genlist *pgenlist, void *dataptr,
                              struct genlist_link *prev,
                              struct genlist_link *next)
 {
-  genlist_link *plink = new genlist_link;
+  genlist_link *plink = link_alloc();
 
   plink->dataptr = dataptr;
   plink->prev = prev;
@@ -121,7 +239,7 @@ static void genlist_link_destroy(struct genlist *pgenlist,
   if (nullptr != pgenlist->free_data_func) {
     pgenlist->free_data_func(plink->dataptr);
   }
-  delete plink;
+  link_free(plink);
 }
 
 /**
@@ -271,12 +389,12 @@ void genlist_clear(struct genlist *pgenlist)
       do {
         plink2 = plink->next;
         free_data_func(plink->dataptr);
-        delete plink;
+        link_free(plink);
       } while (nullptr != (plink = plink2));
     } else {
       do {
         plink2 = plink->next;
-        delete plink;
+        link_free(plink);
       } while (nullptr != (plink = plink2));
     }
   }
@@ -65,15 +65,17 @@
 #include <KCompressionDevice>
 
 // Qt
+#include <QFile>
 #include <QLoggingCategory>
 #include <QString>
+#include <QStringConverter>
+#include <QStringList>
 #include <QStringLiteral>
-#include <QTextStream>
 #include <qstringconverter_base.h> // QT-BUG
 
 // std
 #include <cstdarg> // va_*
-#include <utility> // std:move
+#include <utility> // std::move, std::swap
 
 #define INF_MAGIC (0xabdc0132) // arbitrary
 
@@ -81,7 +83,9 @@ struct inputfile {
   unsigned int magic;        // memory check
   QString filename;          // filename as passed to fopen
   QIODevice *fp;             // read from this
-  QTextStream *stream;       // handles encoding
+  QByteArray data;           // contents of the file, UTF-8 encoded
+  qsizetype data_pos;        // start of the next line in data
+  QStringDecoder decoder;    // decodes lines of data into cur_line
   QString cur_line;          // data from current line
   unsigned int cur_line_pos; // position in current line
   unsigned int line_num;     // line number from file in cur_line
@@ -100,6 +104,8 @@ struct inputfile {
   struct inputfile *included_from; /* nullptr for toplevel file, otherwise
                                       points back to files which this one
                                       has been included from */
+  QStringList *includes;           /* if not nullptr, the files included
+                                      are appended here */
 };
 
 // A function to get a specific token type:
@@ -148,9 +154,12 @@ static void init_zeros(struct inputfile *inf)
   inf->magic = INF_MAGIC;
   inf->filename.clear();
   inf->fp = nullptr;
-  inf->stream = nullptr;
+  inf->data.clear();
+  inf->data_pos = 0;
+  inf->decoder = QStringDecoder(QStringConverter::Utf8);
   inf->datafn = nullptr;
   inf->included_from = nullptr;
+  inf->includes = nullptr;
   inf->line_num = inf->cur_line_pos = 0;
   inf->in_string = false;
   inf->string_start_line = 0;
@@ -194,6 +203,31 @@ static QString inf_filename(struct inputfile *inf)
   }
 }
 
+/**
+   Return an allocated, initialized structure reading from data. The
+   device fp is owned by the structure and must stay open while data is
+   used.
+ */
+static struct inputfile *inf_from_data(QIODevice *fp, QByteArray data,
+                                       datafilename_fn_t datafn)
+{
+  auto inf = new inputfile;
+  init_zeros(inf);
+
+  // Lines are decoded as UTF-8 when they are read. Files in UTF-16 and
+  // UTF-32 are recognized by their byte order mark, and converted once.
+  auto encoding = QStringConverter::encodingForData(data);
+  if (encoding && *encoding != QStringConverter::Utf8) {
+    auto decoder = QStringDecoder(*encoding);
+    data = QString(decoder(data)).toUtf8();
+  }
+
+  inf->fp = fp;
+  inf->data = std::move(data);
+  inf->datafn = datafn;
+  return inf;
+}
+
 /**
    Open the file, and return an allocated, initialized structure.
    Returns nullptr if the file could not be opened.
@@ -211,8 +245,37 @@ struct inputfile *inf_from_file(const QString &filename,
     delete fp;
     return nullptr;
   }
+
+  // Plain files are mapped instead of being copied to memory
+  if (fp->compressionType() == KCompressionDevice::None) {
+    auto file = new QFile(filename);
+    uchar *mapped = nullptr;
+    if (file->open(QIODevice::ReadOnly) && file->size() > 0) {
+      mapped = file->map(0, file->size());
+    }
+    if (mapped != nullptr) {
+      delete fp;
+      qCDebug(inf_category) << "mapped" << filename << "ok";
+      inf = inf_from_data(
+          file,
+          QByteArray::fromRawData(reinterpret_cast<const char *>(mapped),
+                                  file->size()),
+          datafn);
+      inf->filename = filename;
+      return inf;
+    }
+    delete file;
+  }
+
+  auto data = fp->readAll();
+  if (fp->error() != 0) {
+    // TRANS: Error reading <file>: <reason>
+    qCCritical(inf_category) << QString::fromUtf8(_("Error reading %1: %2"))
+                                    .arg(filename)
+                                    .arg(fp->errorString());
+  }
   qCDebug(inf_category) << "opened" << filename << "ok";
-  inf = inf_from_stream(fp, datafn);
+  inf = inf_from_data(fp, std::move(data), datafn);
   inf->filename = filename;
   return inf;
 }
@@ -227,15 +290,7 @@ struct inputfile *inf_from_stream(QIODevice *stream,
   struct inputfile *inf;
 
   fc_assert_ret_val(nullptr != stream, nullptr);
-  inf = new inputfile;
-  init_zeros(inf);
-
-  inf->filename.clear();
-  inf->fp = stream;
-  inf->stream = new QTextStream(stream);
-  inf->stream->setEncoding(QStringConverter::Utf8);
-  inf->stream->setAutoDetectUnicode(true); // Allow UTF-16 and UTF-32
-  inf->datafn = datafn;
+  inf = inf_from_data(stream, stream->readAll(), datafn);
 
   qCDebug(inf_category) << "opened" << inf_filename(inf) << "ok";
   return inf;
@@ -262,8 +317,8 @@ static void inf_close_partial(struct inputfile *inf)
     qCCritical(inf_category) << "Error before closing" << inf_filename(inf)
                              << ":" << inf->fp->errorString();
   }
-  delete inf->stream;
-  inf->stream = nullptr;
+  // Release data first, it may point to memory mapped by fp
+  inf->data.clear();
 
   delete inf->fp;
   inf->fp = nullptr;
@@ -316,6 +371,16 @@ static bool at_eol(struct inputfile *inf)
   return inf->cur_line_pos >= inf->cur_line.length() - 1;
 }
 
+/**
+   Record the files included by inf, at any depth, in includes. The list
+   must outlive the reading of the file.
+ */
+void inf_record_includes(struct inputfile *inf, QStringList *includes)
+{
+  fc_assert_ret(inf_sanity_check(inf));
+  inf->includes = includes;
+}
+
 /**
    Return TRUE if current pos is at end of file.
  */
@@ -323,7 +388,8 @@ bool inf_at_eof(struct inputfile *inf)
 {
   fc_assert_ret_val(inf_sanity_check(inf), true);
 
-  return inf->included_from == nullptr && inf->stream->atEnd()
+  return inf->included_from == nullptr
+         && inf->data_pos >= inf->data.size()
          && inf->cur_line_pos >= inf->cur_line.length();
 }
 
@@ -337,7 +403,7 @@ bool inf_at_eof(struct inputfile *inf)
  */
 static bool check_include(struct inputfile *inf)
 {
-  struct inputfile *new_inf, temp;
+  struct inputfile *new_inf;
 
   fc_assert_ret_val(inf_sanity_check(inf), false);
   if (inf->in_string || inf->cur_line_pos > 0) {
@@ -412,15 +478,17 @@ static bool check_include(struct inputfile *inf)
   }
 
   new_inf = inf_from_file(qUtf8Printable(full_name), inf->datafn);
+  if (inf->includes != nullptr) {
+    inf->includes->append(full_name);
+  }
+  new_inf->includes = inf->includes;
 
   /* Swap things around so that memory pointed to by inf (user pointer,
      and pointer in calling functions) contains the new inputfile,
      and newly allocated memory for new_inf contains the old inputfile.
      This is pretty scary, lets hope it works...
   */
-  temp = *new_inf;
-  *new_inf = *inf;
-  *inf = temp;
+  std::swap(*new_inf, *inf);
   inf->included_from = new_inf;
   return true;
 }
@@ -458,24 +526,30 @@ static bool read_a_line(struct inputfile *inf)
   fc_assert_ret_val(inf_sanity_check(inf), false);
 
   // eof
-  if (inf->stream->atEnd() && inf->cur_line_pos >= inf->cur_line.length()) {
+  if (inf->data_pos >= inf->data.size()
+      && inf->cur_line_pos >= inf->cur_line.length()) {
     return stop_reading(inf);
   }
 
-  // Read a full line. Only ASCII line separators are valid.
-  // First get the data. Proper error handling makes this terrible...
-  QString line;
-  const auto ok = inf->stream->readLineInto(&inf->cur_line, 0);
-  if (!ok && !inf->fp->atEnd()) {
-    // TRANS: Error reading <file>: <reason>
-    qCCritical(inf_category) << QString::fromUtf8(_("Error reading %1: %2"))
-                                    .arg(inf->filename)
-                                    .arg(inf->fp->errorString());
-    return stop_reading(inf);
-  }
-
-  // Normal behavior
-  inf->cur_line += '\n'; // The parsing code needs a termination character.
+  // Find the end of the line. Only ASCII line separators are valid.
+  auto end = inf->data.indexOf('\n', inf->data_pos);
+  if (end < 0) {
+    end = inf->data.size();
+  }
+  auto length = end - inf->data_pos;
+  if (length > 0 && inf->data.at(end - 1) == '\r') {
+    length--;
+  }
+  const auto line =
+      QByteArrayView(inf->data.constData() + inf->data_pos, length);
+  inf->data_pos = end + 1;
+
+  /* Decode into the buffer of the previous line; UTF-16 never needs more
+     code units than UTF-8 needs bytes. */
+  inf->cur_line.resize(length + 1);
+  auto last = inf->decoder.appendToBuffer(inf->cur_line.data(), line);
+  *last++ = '\n'; // The parsing code needs a termination character.
+  inf->cur_line.truncate(last - inf->cur_line.constData());
   inf->cur_line_pos = 0;
   inf->line_num++;
 
@@ -664,7 +738,7 @@ static QString get_token_eol(struct inputfile *inf)
   }
 
   // finished with this line: say that we don't have it any more
-  inf->cur_line.clear();
+  inf->cur_line.truncate(0); // Keeps the buffer for the next line
   inf->cur_line_pos = 0;
 
   inf->token = QStringLiteral(" ");
@@ -801,6 +875,9 @@ static QString get_token_value(struct inputfile *inf)
                  qUtf8Printable(name));
       return "";
     }
+    if (inf->includes != nullptr) {
+      inf->includes->append(rfname);
+    }
     auto fp = new KCompressionDevice(rfname);
     std::ignore = fp->open(QIODevice::ReadOnly);
     if (!fp->isOpen()) {
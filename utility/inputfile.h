@@ -12,6 +12,7 @@
 #include "support.h" // bool type and fc__attribute
 
 // Qt
+#include <QStringList>
 class QString;
 class QIODevice;
 
@@ -24,6 +25,7 @@ struct inputfile *inf_from_file(const QString &filename,
 struct inputfile *inf_from_stream(QIODevice *stream,
                                   datafilename_fn_t datafn);
 void inf_close(struct inputfile *inf);
+void inf_record_includes(struct inputfile *inf, QStringList *includes);
 bool inf_at_eof(struct inputfile *inf);
 
 enum inf_token_type {
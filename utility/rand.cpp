@@ -156,3 +156,113 @@ std::uint_fast32_t fc_randomly_debug(std::uint_fast32_t seed,
 
   return result;
 }
+
+namespace {
+/**
+ * SplitMix64 finalizer, a bijective mixing function on 64 bits.
+ */
+std::uint64_t mix64(std::uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Combines a key with a new value, giving a key for a child stream.
+ */
+std::uint64_t mix_key(std::uint64_t key, std::uint64_t value)
+{
+  return mix64(key ^ mix64(value + 0x9e3779b97f4a7c15ULL));
+}
+
+/// Seed of all counter-based streams, see fc_rand_stream.
+std::uint64_t stream_seed = 0;
+} // anonymous namespace
+
+/**
+   Counter-based pseudo-random function: returns a value in the interval 0
+   to (size-1) inclusive that only depends on key and counter. Unlike
+   fc_rand() it has no state, so it can be called in any order and from
+   any thread. Typically the key is drawn once from fc_rand() and the
+   counter identifies the entity (e.g. a tile index) the value is for.
+
+   Uses the SplitMix64 finalizer, which is a good enough bijection for
+   consecutive counters to give independent looking values.
+ */
+std::uint_fast32_t fc_rand_keyed(std::uint64_t key, std::uint64_t counter,
+                                 std::uint_fast32_t size)
+{
+  if (size <= 1) {
+    return 0;
+  }
+  fc_assert_ret_val(size <= MAX_UINT32, 0);
+
+  std::uint64_t z = mix64(key + (counter + 1) * 0x9e3779b97f4a7c15ULL);
+
+  // Map the upper 32 bits to [0, size) without a division.
+  return static_cast<std::uint_fast32_t>(((z >> 32) * size) >> 32);
+}
+
+/**
+   Returns the seed of all counter-based random streams.
+ */
+std::uint64_t fc_rand_stream_seed() { return stream_seed; }
+
+/**
+   Sets the seed of all counter-based random streams; eg when loading a
+   game.
+ */
+void fc_rand_set_stream_seed(std::uint64_t seed) { stream_seed = seed; }
+
+/**
+   Derives the seed of the counter-based random streams from the current
+   state of the global generator, without advancing it.
+ */
+void fc_rand_init_stream_seed()
+{
+  auto copy = generator;
+  std::uint64_t high = copy(), low = copy();
+
+  stream_seed = mix64((high << 32) | low);
+}
+
+/**
+   Creates the stream for the given turn, subsystem and entity. The
+   subsystem must be a constant identifying the code drawing the values,
+   so that two subsystems drawing for the same entity get different
+   values.
+ */
+fc_rand_stream::fc_rand_stream(std::uint64_t turn, std::uint32_t subsystem,
+                               std::uint64_t entity)
+    : m_key(mix_key(mix_key(mix_key(stream_seed, turn), subsystem), entity))
+{
+}
+
+/**
+   Returns an independent child stream, eg for one of several entities
+   handled together.
+ */
+fc_rand_stream fc_rand_stream::split(std::uint64_t id) const
+{
+  return fc_rand_stream(mix_key(m_key, id));
+}
+
+/**
+   Returns the next value of the stream, in the interval 0 to (size-1)
+   inclusive.
+ */
+std::uint_fast32_t fc_rand_stream::operator()(std::uint_fast32_t size)
+{
+  return fc_rand_keyed(m_key, m_counter++, size);
+}
+
+/**
+   Returns the value number 'counter' of the stream, in the interval 0 to
+   (size-1) inclusive, without changing the stream position.
+ */
+std::uint_fast32_t fc_rand_stream::at(std::uint64_t counter,
+                                      std::uint_fast32_t size) const
+{
+  return fc_rand_keyed(m_key, counter, size);
+}
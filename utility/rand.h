@@ -31,3 +31,51 @@ std::uint_fast32_t fc_randomly_debug(std::uint_fast32_t seed,
                                      std::uint_fast32_t size,
                                      const char *called_as, int line,
                                      const char *file);
+
+/*===*/
+
+std::uint_fast32_t fc_rand_keyed(std::uint64_t key, std::uint64_t counter,
+                                 std::uint_fast32_t size);
+
+/* Identifies the code drawing from a counter-based random stream. Values
+ * are part of the game's random sequence: append only, never reorder. */
+enum fc_rand_subsystem {
+  RAND_SUB_EXTRA_DISAPPEARANCE = 1,
+  RAND_SUB_EXTRA_APPEARANCE = 2,
+};
+
+std::uint64_t fc_rand_stream_seed();
+void fc_rand_set_stream_seed(std::uint64_t seed);
+void fc_rand_init_stream_seed();
+
+/**
+ * A counter-based random stream. Unlike fc_rand(), a stream does not
+ * depend on any global call order: its values are fully determined by the
+ * stream seed (saved with the game), the turn, the subsystem drawing the
+ * values and the entity they are drawn for. Streams can be created and
+ * used concurrently from any thread.
+ *
+ * Values can either be drawn in sequence with operator(), or addressed
+ * directly with at() when the caller has a natural counter such as a tile
+ * index.
+ */
+class fc_rand_stream {
+public:
+  fc_rand_stream(std::uint64_t turn, std::uint32_t subsystem,
+                 std::uint64_t entity);
+
+  fc_rand_stream split(std::uint64_t id) const;
+
+  std::uint_fast32_t operator()(std::uint_fast32_t size);
+  std::uint_fast32_t at(std::uint64_t counter,
+                        std::uint_fast32_t size) const;
+
+  /// Returns the key all values of this stream are derived from.
+  std::uint64_t key() const { return m_key; }
+
+private:
+  explicit fc_rand_stream(std::uint64_t key) : m_key(key) {}
+
+  std::uint64_t m_key;
+  std::uint64_t m_counter = 0;
+};
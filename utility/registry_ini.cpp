@@ -152,13 +152,19 @@
 #include "section_file.h"
 #include "shared.h"
 #include "support.h"
+#include "version.h"
 
 // KArchive dependency
 #include <KCompressionDevice>
 
 // Qt
 #include <QByteArrayAlgorithms> // qstrlen, qstrdup
-#include <QLoggingCategory>     // qCCritical. qCWarning
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QLoggingCategory> // qCCritical. qCWarning
+#include <QSaveFile>
 #include <QString>
 #include <QStringLiteral>
 #include <QtContainerFwd> // QVector<QString>
@@ -259,8 +265,9 @@ static bool secfile_hash_insert(struct section_file *secfile,
   }
 
   entry_path(pentry, buf, sizeof(buf));
+  const auto path = QByteArray(buf);
 
-  hentry = secfile->hash.entries->value(buf, nullptr);
+  hentry = secfile->hash.entries->value(path, nullptr);
   if (hentry) {
     entry_use(hentry);
     if (!secfile->allow_duplicates) {
@@ -269,7 +276,7 @@ static bool secfile_hash_insert(struct section_file *secfile,
       return false;
     }
   }
-  secfile->hash.entries->insert(buf, pentry);
+  secfile->hash.entries->insert(path, pentry);
   return true;
 }
 
@@ -288,7 +295,7 @@ static bool secfile_hash_delete(struct section_file *secfile,
   }
 
   entry_path(pentry, buf, sizeof(buf));
-  secfile->hash.entries->remove(buf);
+  secfile->hash.entries->remove(QByteArray::fromRawData(buf, qstrlen(buf)));
   return true;
 }
 
@@ -541,7 +548,7 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
   if (!error) {
     // Build the entry hash table.
     secfile->allow_duplicates = allow_duplicates;
-    secfile->hash.entries = new QMultiHash<QString, struct entry *>;
+    secfile->hash.entries = new QMultiHash<QByteArray, struct entry *>;
     section_list_iterate(secfile->sections, hashing_section)
     {
       entry_list_iterate(section_entries(hashing_section), pentry)
@@ -589,6 +596,258 @@ struct section_file *secfile_from_stream(QIODevice *stream,
                                  nullptr, nullptr, allow_duplicates);
 }
 
+/**
+   Returns the SHA-1 of the contents of the file, or an empty array if it
+   cannot be read.
+ */
+static QByteArray file_digest(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(&file);
+  return hash.result();
+}
+
+/**
+   Writes the sections and entries of secfile to out.
+ */
+static void secfile_serialize(const struct section_file *secfile,
+                              QDataStream &out)
+{
+  out << qint32(section_list_size(secfile->sections));
+  section_list_iterate(secfile->sections, psection)
+  {
+    out << QByteArray(psection->name) << qint32(psection->special)
+        << qint32(entry_list_size(psection->entries));
+    entry_list_iterate(psection->entries, pentry)
+    {
+      out << QByteArray(pentry->name) << qint32(pentry->type)
+          << QByteArray(pentry->comment);
+      switch (pentry->type) {
+      case ENTRY_BOOL:
+        out << pentry->boolean.value;
+        break;
+      case ENTRY_INT:
+        out << qint32(pentry->integer.value);
+        break;
+      case ENTRY_FLOAT:
+        out << pentry->floating.value;
+        break;
+      case ENTRY_STR:
+        out << QByteArray(pentry->string.value) << pentry->string.escaped
+            << pentry->string.raw << pentry->string.gt_marking;
+        break;
+      case ENTRY_FILEREFERENCE:
+        out << QByteArray(pentry->string.value);
+        break;
+      case ENTRY_ILLEGAL:
+        fc_assert(pentry->type != ENTRY_ILLEGAL);
+        break;
+      }
+    }
+    entry_list_iterate_end;
+  }
+  section_list_iterate_end;
+}
+
+/**
+   Reads a section file written by secfile_serialize(). Returns nullptr if
+   the data is corrupt.
+ */
+static struct section_file *secfile_deserialize(QDataStream &in,
+                                                const QString &filename,
+                                                bool allow_duplicates)
+{
+  struct section_file *secfile = secfile_new(true);
+  secfile->name = fc_strdup(qUtf8Printable(filename));
+
+  qint32 num_sections = 0;
+  in >> num_sections;
+  for (int i = 0; i < num_sections && in.status() == QDataStream::Ok; i++) {
+    QByteArray section_name;
+    qint32 special = EST_NORMAL, num_entries = 0;
+    in >> section_name >> special >> num_entries;
+
+    auto psection =
+        secfile_section_new(secfile, QString::fromUtf8(section_name));
+    if (psection == nullptr) {
+      secfile_destroy(secfile);
+      return nullptr;
+    }
+    psection->special = entry_special_type(special);
+
+    for (int j = 0; j < num_entries && in.status() == QDataStream::Ok;
+         j++) {
+      QByteArray name, comment;
+      qint32 type = ENTRY_ILLEGAL;
+      in >> name >> type >> comment;
+      const auto entry_name = QString::fromUtf8(name);
+
+      struct entry *pentry = nullptr;
+      switch (type) {
+      case ENTRY_BOOL: {
+        bool value = false;
+        in >> value;
+        pentry = section_entry_bool_new(psection, entry_name, value);
+      } break;
+      case ENTRY_INT: {
+        qint32 value = 0;
+        in >> value;
+        pentry = section_entry_int_new(psection, entry_name, value);
+      } break;
+      case ENTRY_FLOAT: {
+        float value = 0;
+        in >> value;
+        pentry = section_entry_float_new(psection, entry_name, value);
+      } break;
+      case ENTRY_STR: {
+        QByteArray value;
+        bool escaped = true, raw = false, gt_marking = false;
+        in >> value >> escaped >> raw >> gt_marking;
+        pentry = section_entry_str_new(psection, entry_name,
+                                       QString::fromUtf8(value), escaped);
+        if (pentry != nullptr) {
+          pentry->string.raw = raw;
+          pentry->string.gt_marking = gt_marking;
+        }
+      } break;
+      case ENTRY_FILEREFERENCE: {
+        QByteArray value;
+        in >> value;
+        pentry = section_entry_filereference_new(psection, name.constData(),
+                                                 value.constData());
+      } break;
+      }
+      if (pentry == nullptr) {
+        secfile_destroy(secfile);
+        return nullptr;
+      }
+      if (!comment.isEmpty()) {
+        entry_set_comment(pentry, QString::fromUtf8(comment));
+      }
+    }
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    secfile_destroy(secfile);
+    return nullptr;
+  }
+
+  // Build the entry hash table, as in secfile_from_input_file().
+  secfile->allow_duplicates = allow_duplicates;
+  secfile->hash.entries = new QMultiHash<QByteArray, struct entry *>;
+  section_list_iterate(secfile->sections, psection)
+  {
+    entry_list_iterate(section_entries(psection), pentry)
+    {
+      if (!secfile_hash_insert(secfile, pentry)) {
+        secfile_destroy(secfile);
+        return nullptr;
+      }
+    }
+    entry_list_iterate_end;
+  }
+  section_list_iterate_end;
+
+  return secfile;
+}
+
+/**
+   Like secfile_load(), but keeps a parsed copy of the file in cache_dir.
+
+   The copy is used instead of parsing the file as long as the file and
+   every file it includes are unchanged, which is checked by comparing the
+   hashes of their contents. A copy written by another version of
+   Freeciv21 is never used. Errors while reading or writing the cache are
+   not fatal: the file is then parsed as usual.
+ */
+struct section_file *secfile_load_cached(const QString &filename,
+                                         bool allow_duplicates,
+                                         const QString &cache_dir)
+{
+  static const QByteArray magic = QByteArrayLiteral("FC21SECF");
+  const quint32 format = 1;
+
+  const auto real_filename = interpret_tilde(filename);
+  const auto key = QCryptographicHash::hash(
+      (real_filename + (allow_duplicates ? "+" : "-")).toUtf8(),
+      QCryptographicHash::Sha1);
+  const auto cache_name =
+      QDir(cache_dir).filePath(QString::fromLatin1(key.toHex()) + ".sec");
+
+  QFile cache(cache_name);
+  if (cache.open(QIODevice::ReadOnly)) {
+    QDataStream in(&cache);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    QByteArray cache_magic;
+    quint32 cache_format = 0;
+    QByteArray cache_version;
+    in >> cache_magic >> cache_format >> cache_version;
+
+    bool valid = cache_magic == magic && cache_format == format
+                 && cache_version == freeciv21_version();
+    if (valid) {
+      qint32 num_files = 0;
+      in >> num_files;
+      for (int i = 0; i < num_files && valid; i++) {
+        QString dependency;
+        QByteArray digest;
+        in >> dependency >> digest;
+        valid = in.status() == QDataStream::Ok
+                && file_digest(dependency) == digest;
+      }
+    }
+
+    if (valid) {
+      auto secfile = secfile_deserialize(in, filename, allow_duplicates);
+      if (secfile != nullptr) {
+        qDebug("Read registry from cache \"%s\" for \"%s\"",
+               qUtf8Printable(cache_name), qUtf8Printable(filename));
+        return secfile;
+      }
+      qDebug("Corrupt registry cache \"%s\"", qUtf8Printable(cache_name));
+    }
+    cache.close();
+  }
+
+  auto inf = inf_from_file(real_filename, datafilename);
+  if (inf == nullptr) {
+    return nullptr;
+  }
+  QStringList dependencies = {real_filename};
+  inf_record_includes(inf, &dependencies);
+
+  auto secfile =
+      secfile_from_input_file(inf, filename, nullptr, allow_duplicates);
+  if (secfile == nullptr) {
+    return nullptr;
+  }
+
+  // Write to a temporary file first so readers never see half a cache.
+  QSaveFile save(cache_name);
+  if (!QDir().mkpath(cache_dir) || !save.open(QIODevice::WriteOnly)) {
+    qDebug("Cannot write registry cache \"%s\"", qUtf8Printable(cache_name));
+    return secfile;
+  }
+  QDataStream out(&save);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << magic << format << QByteArray(freeciv21_version());
+  out << qint32(dependencies.size());
+  for (const auto &dependency : std::as_const(dependencies)) {
+    out << dependency << file_digest(dependency);
+  }
+  secfile_serialize(secfile, out);
+  if (out.status() != QDataStream::Ok || !save.commit()) {
+    qDebug("Cannot write registry cache \"%s\"", qUtf8Printable(cache_name));
+  }
+
+  return secfile;
+}
+
 /**
    Returns TRUE iff the character is legal in a table entry name.
  */
@@ -1744,7 +2003,9 @@ struct entry *secfile_entry_by_path(const struct section_file *secfile,
   }
 
   if (nullptr != secfile->hash.entries) {
-    struct entry *pentry = secfile->hash.entries->value(fullpath, nullptr);
+    // Look up without copying the path
+    struct entry *pentry = secfile->hash.entries->value(
+        QByteArray::fromRawData(fullpath, qstrlen(fullpath)), nullptr);
 
     if (pentry) {
       entry_use(pentry);
@@ -55,6 +55,9 @@ struct section_file *secfile_load_section(const QString &filename,
                                           bool allow_duplicates);
 struct section_file *secfile_from_stream(QIODevice *stream,
                                          bool allow_duplicates);
+struct section_file *secfile_load_cached(const QString &filename,
+                                         bool allow_duplicates,
+                                         const QString &cache_dir);
 
 bool secfile_save(const struct section_file *secfile, QString filename);
 void secfile_check_unused(const struct section_file *secfile,
@@ -37,7 +37,7 @@ struct section_file {
   bool allow_digital_boolean;
   struct {
     QMultiHash<QString, struct section *> *sections;
-    QMultiHash<QString, struct entry *> *entries;
+    QMultiHash<QByteArray, struct entry *> *entries; // by UTF-8 path
   } hash;
 };
 
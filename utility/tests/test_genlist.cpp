@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+#include <fc_config.h>
+
+// utility
+#include "genlist.h"
+
+// Qt
+#include <QObject>
+#include <QTest>
+
+// std
+#include <cstdint> // std::intptr_t
+#include <thread>
+#include <utility> // std::swap
+
+/**
+ * Tests the generic list and benchmarks its typical uses
+ */
+class test_genlist : public QObject {
+  Q_OBJECT
+
+private slots:
+  void append_remove();
+  void other_thread();
+
+  void benchmark_append_clear();
+  void benchmark_iterate();
+  void benchmark_move();
+};
+
+namespace {
+/// Number of elements used by the benchmarks.
+constexpr int ELEMENTS = 5000;
+
+/**
+ * Fake data pointer for the nth element
+ */
+void *element(int n) { return reinterpret_cast<void *>(std::intptr_t(n)); }
+
+/**
+ * Checks that the links of the list are consistent with its size
+ */
+void verify_links(const struct genlist *plist)
+{
+  int count = 0;
+  const struct genlist_link *prev = nullptr;
+  for (auto plink = genlist_head(plist); plink != nullptr;
+       plink = genlist_link_next(plink)) {
+    QCOMPARE(plink->prev, prev);
+    prev = plink;
+    count++;
+  }
+  QCOMPARE(genlist_tail(plist), prev);
+  QCOMPARE(count, genlist_size(plist));
+}
+} // anonymous namespace
+
+/**
+ * Elements come back in order after removals and reuse of the links
+ */
+void test_genlist::append_remove()
+{
+  auto plist = genlist_new();
+  for (int i = 0; i < ELEMENTS; i++) {
+    genlist_append(plist, element(i));
+  }
+  for (int i = 0; i < ELEMENTS; i += 2) {
+    QVERIFY(genlist_remove(plist, element(i)));
+  }
+  for (int i = 0; i < ELEMENTS; i += 2) {
+    genlist_prepend(plist, element(i));
+  }
+  verify_links(plist);
+  QCOMPARE(genlist_size(plist), ELEMENTS);
+  QCOMPARE(genlist_get(plist, ELEMENTS / 2), element(1));
+  QCOMPARE(genlist_back(plist), element(ELEMENTS - 1));
+
+  genlist_clear(plist);
+  QCOMPARE(genlist_size(plist), 0);
+  genlist_destroy(plist);
+}
+
+/**
+ * Lists can be filled in one thread and emptied in another
+ */
+void test_genlist::other_thread()
+{
+  auto plist = genlist_new();
+  std::thread([plist] {
+    for (int i = 0; i < ELEMENTS; i++) {
+      genlist_append(plist, element(i));
+    }
+  }).join();
+  verify_links(plist);
+  QCOMPARE(genlist_size(plist), ELEMENTS);
+
+  std::thread([plist] { genlist_clear(plist); }).join();
+  QCOMPARE(genlist_size(plist), 0);
+
+  // Reuses the links released by the threads above
+  for (int i = 0; i < ELEMENTS; i++) {
+    genlist_append(plist, element(i));
+  }
+  verify_links(plist);
+  genlist_destroy(plist);
+
+#ifdef FREECIV_GENLIST_POOL
+  // A thread exiting with links it never gave back to an empty pool
+  // still hands them over to the next thread that needs links.
+  auto kept = genlist_new();
+  const struct genlist_link *released = nullptr;
+  std::thread([kept, &released] {
+    genlist_append(kept, element(1));
+    genlist_append(kept, element(2));
+    released = genlist_tail(kept);
+    genlist_remove(kept, element(2));
+  }).join();
+
+  auto other = genlist_new();
+  const struct genlist_link *reused = nullptr;
+  std::thread([other, &reused] {
+    genlist_append(other, element(3));
+    reused = genlist_head(other);
+  }).join();
+  QCOMPARE(reused, released);
+
+  genlist_destroy(kept);
+  genlist_destroy(other);
+#endif // FREECIV_GENLIST_POOL
+}
+
+/**
+ * Building and clearing a list, as done for temporary lists
+ */
+void test_genlist::benchmark_append_clear()
+{
+  auto plist = genlist_new();
+  QBENCHMARK
+  {
+    for (int i = 0; i < ELEMENTS; i++) {
+      genlist_append(plist, element(i));
+    }
+    genlist_clear(plist);
+  }
+  genlist_destroy(plist);
+}
+
+/**
+ * Walking a list that was churned, as done for unit lists late in a game
+ */
+void test_genlist::benchmark_iterate()
+{
+  auto plist = genlist_new();
+  for (int i = 0; i < ELEMENTS; i++) {
+    genlist_append(plist, element(i));
+  }
+  for (int i = 0; i < ELEMENTS; i += 3) {
+    genlist_remove(plist, element(i));
+    genlist_append(plist, element(i));
+  }
+
+  std::intptr_t sum = 0;
+  QBENCHMARK
+  {
+    for (auto plink = genlist_head(plist); plink != nullptr;
+         plink = genlist_link_next(plink)) {
+      sum += reinterpret_cast<std::intptr_t>(genlist_link_data(plink));
+    }
+  }
+  QVERIFY(sum > 0);
+  genlist_destroy(plist);
+}
+
+/**
+ * Moving elements between lists, as done when units change tiles
+ */
+void test_genlist::benchmark_move()
+{
+  auto from = genlist_new(), to = genlist_new();
+  for (int i = 0; i < ELEMENTS; i++) {
+    genlist_append(from, element(i));
+  }
+  QBENCHMARK
+  {
+    while (genlist_size(from) > 0) {
+      genlist_append(to, genlist_front(from));
+      genlist_pop_front(from);
+    }
+    std::swap(from, to);
+  }
+  genlist_destroy(from);
+  genlist_destroy(to);
+}
+
+QTEST_MAIN(test_genlist)
+#include "test_genlist.moc"
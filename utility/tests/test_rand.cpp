@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "rand.h"
+
+// Qt
+#include <QObject>
+#include <QTest>
+
+// std
+#include <array>
+#include <bitset>
+#include <cstdlib> // std::abs
+
+/**
+ * Tests the counter-based random streams
+ */
+class test_rand : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void deterministic();
+  void bounds();
+  void keys_differ();
+  void uniform_data();
+  void uniform();
+  void serial_correlation();
+  void avalanche();
+
+  void benchmark_fc_rand();
+  void benchmark_stream();
+};
+
+namespace {
+/// Number of buckets of the chi-square tests.
+constexpr int BUCKETS = 64;
+/// Number of values drawn for the statistical tests.
+constexpr int SAMPLES = 1 << 20;
+
+/**
+ * Chi-square statistic of the bucket counts against a uniform
+ * distribution.
+ */
+double chi_square(const std::array<int, BUCKETS> &counts, int total)
+{
+  const double expected = double(total) / BUCKETS;
+  double chi2 = 0.0;
+
+  for (int count : counts) {
+    chi2 += (count - expected) * (count - expected) / expected;
+  }
+  return chi2;
+}
+
+/**
+ * Upper bound of the chi-square statistic with BUCKETS - 1 degrees of
+ * freedom that a uniform source exceeds with a probability below 1e-4.
+ */
+constexpr double CHI2_LIMIT = 118.0;
+} // anonymous namespace
+
+/**
+ * Uses a fixed seed so that failures are reproducible
+ */
+void test_rand::initTestCase()
+{
+  fc_srand(42);
+  fc_rand_set_stream_seed(0x0123456789abcdefULL);
+}
+
+/**
+ * Streams with the same parameters give the same values, whatever the order
+ */
+void test_rand::deterministic()
+{
+  fc_rand_stream a(10, RAND_SUB_EXTRA_APPEARANCE, 3);
+  fc_rand_stream b(10, RAND_SUB_EXTRA_APPEARANCE, 3);
+
+  for (int i = 0; i < 100; i++) {
+    QCOMPARE(a(1000), b.at(i, 1000));
+  }
+  for (int i = 99; i >= 0; i--) {
+    QCOMPARE(a.at(i, 1000), b.at(i, 1000));
+  }
+  QCOMPARE(a.split(7).key(), b.split(7).key());
+
+  // The seed is part of the key
+  auto seed = fc_rand_stream_seed();
+  fc_rand_set_stream_seed(seed + 1);
+  QVERIFY(fc_rand_stream(10, RAND_SUB_EXTRA_APPEARANCE, 3).key() != a.key());
+  fc_rand_set_stream_seed(seed);
+
+  // Initializing from the global generator does not advance it
+  auto state = fc_rand_state();
+  fc_rand_init_stream_seed();
+  QVERIFY(state == fc_rand_state());
+  fc_rand_set_stream_seed(seed);
+}
+
+/**
+ * Values are always in range
+ */
+void test_rand::bounds()
+{
+  fc_rand_stream stream(1, RAND_SUB_EXTRA_APPEARANCE, 1);
+
+  QCOMPARE(stream(0), std::uint_fast32_t(0));
+  QCOMPARE(stream(1), std::uint_fast32_t(0));
+  for (unsigned size : {2u, 3u, 7u, 10000u, 0xfffffffeu}) {
+    for (int i = 0; i < 1000; i++) {
+      QVERIFY(stream(size) < size);
+    }
+  }
+}
+
+/**
+ * Changing any of the stream parameters changes the key
+ */
+void test_rand::keys_differ()
+{
+  const auto base = fc_rand_stream(5, RAND_SUB_EXTRA_APPEARANCE, 9).key();
+
+  QVERIFY(fc_rand_stream(6, RAND_SUB_EXTRA_APPEARANCE, 9).key() != base);
+  QVERIFY(fc_rand_stream(5, RAND_SUB_EXTRA_DISAPPEARANCE, 9).key() != base);
+  QVERIFY(fc_rand_stream(5, RAND_SUB_EXTRA_APPEARANCE, 10).key() != base);
+  QVERIFY(fc_rand_stream(5, RAND_SUB_EXTRA_APPEARANCE, 9).split(0).key()
+          != base);
+  // Swapping parameters must not give the same stream
+  QVERIFY(fc_rand_stream(9, RAND_SUB_EXTRA_APPEARANCE, 5).key() != base);
+}
+
+/**
+ * Streams to run the uniformity test on
+ */
+void test_rand::uniform_data()
+{
+  QTest::addColumn<int>("entity_step");
+  QTest::addColumn<int>("counter_step");
+
+  // Consecutive values of one stream
+  QTest::newRow("sequential") << 0 << 1;
+  // First value of consecutive entities, as used for per-tile draws
+  QTest::newRow("entities") << 1 << 0;
+}
+
+/**
+ * Chi-square test of the distribution of the values
+ */
+void test_rand::uniform()
+{
+  QFETCH(int, entity_step);
+  QFETCH(int, counter_step);
+
+  std::array<int, BUCKETS> counts{};
+  for (int i = 0; i < SAMPLES; i++) {
+    fc_rand_stream stream(1, RAND_SUB_EXTRA_APPEARANCE, i * entity_step);
+    counts[stream.at(i * counter_step, BUCKETS)]++;
+  }
+
+  QVERIFY2(chi_square(counts, SAMPLES) < CHI2_LIMIT,
+           qPrintable(QString::number(chi_square(counts, SAMPLES))));
+}
+
+/**
+ * Chi-square test of pairs of consecutive values
+ */
+void test_rand::serial_correlation()
+{
+  constexpr int SIDE = 8;
+  static_assert(SIDE * SIDE == BUCKETS);
+
+  fc_rand_stream stream(1, RAND_SUB_EXTRA_DISAPPEARANCE, 0);
+  std::array<int, BUCKETS> counts{};
+  for (int i = 0; i < SAMPLES; i++) {
+    auto first = stream(SIDE);
+    counts[first * SIDE + stream(SIDE)]++;
+  }
+
+  QVERIFY2(chi_square(counts, SAMPLES) < CHI2_LIMIT,
+           qPrintable(QString::number(chi_square(counts, SAMPLES))));
+}
+
+/**
+ * Flipping one bit of the entity flips about half the bits of the values
+ */
+void test_rand::avalanche()
+{
+  constexpr int ROUNDS = 1000;
+  constexpr unsigned FULL = 0xffffffffu;
+
+  for (int bit = 0; bit < 64; bit++) {
+    long flipped = 0;
+
+    for (int i = 0; i < ROUNDS; i++) {
+      const std::uint64_t entity = std::uint64_t(i) * 0x9e3779b97f4a7c15ULL;
+      fc_rand_stream a(1, RAND_SUB_EXTRA_APPEARANCE, entity);
+      fc_rand_stream b(1, RAND_SUB_EXTRA_APPEARANCE,
+                       entity ^ (std::uint64_t(1) << bit));
+
+      flipped += std::bitset<32>(a.at(0, FULL) ^ b.at(0, FULL)).count();
+    }
+
+    // 32000 bits, each flipped with probability 1/2: sigma is ~90
+    QVERIFY2(std::abs(flipped - 16 * ROUNDS) < 800,
+             qPrintable(QStringLiteral("bit %1: %2").arg(bit).arg(flipped)));
+  }
+}
+
+/**
+ * Throughput of the global generator, for comparison
+ */
+void test_rand::benchmark_fc_rand()
+{
+  unsigned sum = 0;
+  QBENCHMARK
+  {
+    for (int i = 0; i < 100000; i++) {
+      sum += fc_rand(10000);
+    }
+  }
+  QVERIFY(sum > 0);
+}
+
+/**
+ * Throughput of the counter-based streams
+ */
+void test_rand::benchmark_stream()
+{
+  fc_rand_stream stream(1, RAND_SUB_EXTRA_APPEARANCE, 0);
+  unsigned sum = 0;
+  QBENCHMARK
+  {
+    for (int i = 0; i < 100000; i++) {
+      sum += stream(10000);
+    }
+  }
+  QVERIFY(sum > 0);
+}
+
+QTEST_MAIN(test_rand)
+#include "test_rand.moc"
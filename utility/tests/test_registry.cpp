@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "registry.h"
+#include "registry_ini.h"
+
+// Qt
+#include <QBuffer>
+#include <QFile>
+#include <QObject>
+#include <QStringEncoder>
+#include <QTemporaryDir>
+#include <QTest>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+/**
+ * Tests reading section files and benchmarks loading large ones
+ */
+class test_registry : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void line_endings_data();
+  void line_endings();
+  void encodings();
+  void multi_line_string();
+
+  void benchmark_load();
+  void benchmark_lookup();
+
+private:
+  QTemporaryDir dir;
+  QString savegame;
+};
+
+namespace {
+/// Number of players, and of units per player, in the generated savegame.
+constexpr int PLAYERS = 16;
+constexpr int UNITS = 500;
+
+/**
+ * Reads a section file from memory
+ */
+struct section_file *read_secfile(const QByteArray &contents)
+{
+  QBuffer *buffer = new QBuffer; // Deleted with the inputfile
+  buffer->setData(contents);
+  buffer->open(QIODevice::ReadOnly);
+  return secfile_from_stream(buffer, false);
+}
+
+/**
+ * Returns the peak memory use of the process in kB, if known
+ */
+long peak_memory()
+{
+#ifdef Q_OS_UNIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return usage.ru_maxrss;
+  }
+#endif
+  return 0;
+}
+} // anonymous namespace
+
+/**
+ * Writes a savegame-like file with many tables
+ */
+void test_registry::initTestCase()
+{
+  QVERIFY(dir.isValid());
+  savegame = dir.filePath(QStringLiteral("savegame.sav"));
+
+  QFile file(savegame);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  for (int p = 0; p < PLAYERS; p++) {
+    file.write(QStringLiteral("[player%1]\n").arg(p).toUtf8());
+    file.write("name = \"Player\"\nnation = \"Nation\"\ngold = 1234\n");
+    file.write("u = { \"id\", \"x\", \"y\", \"type_by_name\", \"veteran\", "
+               "\"hp\", \"moves\", \"activity\", \"done_moving\", "
+               "\"orders_list\"\n");
+    for (int u = 0; u < UNITS; u++) {
+      file.write(QStringLiteral("  %1, %2, %3, \"Warriors\", 0, 10, 3, "
+                                "\"Idle\", FALSE, \"\"\n")
+                     .arg(p * UNITS + u)
+                     .arg(u % 80)
+                     .arg(u / 80)
+                     .toUtf8());
+    }
+    file.write("}\n\n");
+  }
+}
+
+/**
+ * All line endings give the same entries
+ */
+void test_registry::line_endings_data()
+{
+  QTest::addColumn<QByteArray>("contents");
+  QTest::newRow("LF") << QByteArray("[s]\na = 1\nb = \"x\"\n");
+  QTest::newRow("CRLF") << QByteArray("[s]\r\na = 1\r\nb = \"x\"\r\n");
+  QTest::newRow("no final newline") << QByteArray("[s]\na = 1\nb = \"x\"");
+}
+
+void test_registry::line_endings()
+{
+  QFETCH(QByteArray, contents);
+
+  auto secfile = read_secfile(contents);
+  QVERIFY(secfile != nullptr);
+  QCOMPARE(secfile_lookup_int_default(secfile, 0, "s.a"), 1);
+  QCOMPARE(secfile_lookup_str_default(secfile, "", "s.b"), "x");
+  secfile_destroy(secfile);
+}
+
+/**
+ * Files with a byte order mark are decoded accordingly
+ */
+void test_registry::encodings()
+{
+  const auto text = QStringLiteral("[s]\nname = \"Zürich\"\n");
+  for (auto encoding : {QStringConverter::Utf8, QStringConverter::Utf16LE,
+                        QStringConverter::Utf32BE}) {
+    auto encoder = QStringEncoder(encoding, QStringEncoder::Flag::WriteBom);
+    auto secfile = read_secfile(encoder(text));
+    QVERIFY(secfile != nullptr);
+    QCOMPARE(secfile_lookup_str_default(secfile, "", "s.name"),
+             "Z\xc3\xbcrich");
+    secfile_destroy(secfile);
+  }
+}
+
+/**
+ * Strings can span several lines
+ */
+void test_registry::multi_line_string()
+{
+  auto secfile =
+      read_secfile("[s]\ntext = _(\"first\nsecond\")\nafter = 2\n");
+  QVERIFY(secfile != nullptr);
+  QCOMPARE(secfile_lookup_str_default(secfile, "", "s.text"),
+           "first\nsecond");
+  QCOMPARE(secfile_lookup_int_default(secfile, 0, "s.after"), 2);
+  secfile_destroy(secfile);
+}
+
+/**
+ * Loading a large savegame. The growth of the peak memory use is reported
+ * on platforms where it is known.
+ */
+void test_registry::benchmark_load()
+{
+  const auto memory_before = peak_memory();
+  QBENCHMARK
+  {
+    auto secfile = secfile_load(savegame, false);
+    QVERIFY(secfile != nullptr);
+    secfile_destroy(secfile);
+  }
+  if (memory_before > 0) {
+    qInfo() << "Peak memory use grew by" << peak_memory() - memory_before
+            << "kB";
+  }
+}
+
+/**
+ * Looking up every unit field, as done when loading a game
+ */
+void test_registry::benchmark_lookup()
+{
+  auto secfile = secfile_load(savegame, false);
+  QVERIFY(secfile != nullptr);
+
+  int sum = 0;
+  QBENCHMARK
+  {
+    for (int p = 0; p < PLAYERS; p++) {
+      for (int u = 0; u < UNITS; u++) {
+        sum += secfile_lookup_int_default(secfile, 0, "player%d.u%d.x", p,
+                                          u);
+        sum += secfile_lookup_int_default(secfile, 0, "player%d.u%d.hp", p,
+                                          u);
+        sum += qstrlen(secfile_lookup_str_default(
+            secfile, "", "player%d.u%d.type_by_name", p, u));
+      }
+    }
+  }
+  QVERIFY(sum > 0);
+  secfile_destroy(secfile);
+}
+
+QTEST_GUILESS_MAIN(test_registry)
+#include "test_registry.moc"
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: Freeciv21 and Freeciv Contributors
+
+// utility
+#include "registry.h"
+#include "registry_ini.h"
+
+// Qt
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+/**
+ * Tests the cache of parsed section files
+ */
+class test_registry_cache : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+
+  void round_trip();
+  void invalidation();
+
+private:
+  QTemporaryDir data_dir;
+  QString cache_dir;
+};
+
+namespace {
+/**
+ * Writes contents to a file
+ */
+void write_file(const QString &filename, const QByteArray &contents)
+{
+  QFile file(filename);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  QCOMPARE(file.write(contents), contents.size());
+}
+
+/**
+ * Returns the contents of a saved section file
+ */
+QByteArray saved(const struct section_file *secfile, const QString &name)
+{
+  if (!secfile_save(secfile, name)) {
+    return QByteArray();
+  }
+  QFile file(name);
+  return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+} // anonymous namespace
+
+/**
+ * Sets up the data path so included files are found
+ */
+void test_registry_cache::initTestCase()
+{
+  QVERIFY(data_dir.isValid());
+  qputenv("FREECIV_DATA_PATH", data_dir.path().toUtf8());
+  cache_dir = data_dir.filePath(QStringLiteral("cache"));
+
+  write_file(data_dir.filePath(QStringLiteral("main.ruleset")),
+             "[section]\n"
+             "name = \"quoted \\\"value\\\"\"\n"
+             "raw = $raw \\n value$\n"
+             "translated = _(\"Translated\")\n"
+             "number = -42\n"
+             "flag = TRUE\n"
+             "text = *text.txt*\n"
+             "ratio = 1.5\n"
+             "vector = 1, 2, 3\n"
+             "table = { \"id\", \"name\"\n"
+             "  1, \"one\"\n"
+             "  2, \"two\"\n"
+             "}\n"
+             "\n"
+             "*include \"included.ruleset\"\n");
+  write_file(data_dir.filePath(QStringLiteral("included.ruleset")),
+             "[included]\n"
+             "value = 1\n");
+  write_file(data_dir.filePath(QStringLiteral("text.txt")), "Old text");
+}
+
+/**
+ * A file read from the cache is identical to the parsed file
+ */
+void test_registry_cache::round_trip()
+{
+  const auto filename = data_dir.filePath(QStringLiteral("main.ruleset"));
+
+  auto parsed = secfile_load_cached(filename, false, cache_dir);
+  QVERIFY(parsed != nullptr);
+  const auto cache_files = QDir(cache_dir).entryList(QDir::Files);
+  QCOMPARE(cache_files.size(), 1);
+
+  // A cache hit leaves the cache file alone
+  const auto old_time = QDateTime::currentDateTime().addDays(-1);
+  {
+    QFile cache(QDir(cache_dir).filePath(cache_files.first()));
+    QVERIFY(cache.open(QIODevice::ReadWrite));
+    QVERIFY(cache.setFileTime(old_time, QFileDevice::FileModificationTime));
+  }
+  auto cached = secfile_load_cached(filename, false, cache_dir);
+  QVERIFY(cached != nullptr);
+  QCOMPARE(QFileInfo(QDir(cache_dir).filePath(cache_files.first()))
+               .lastModified()
+               .toSecsSinceEpoch(),
+           old_time.toSecsSinceEpoch());
+
+  QCOMPARE(secfile_lookup_int_default(cached, 0, "included.value"), 1);
+  QCOMPARE(secfile_lookup_str_default(cached, "", "section.table1.name"),
+           "two");
+  QCOMPARE(saved(cached, data_dir.filePath(QStringLiteral("cached.out"))),
+           saved(parsed, data_dir.filePath(QStringLiteral("parsed.out"))));
+
+  secfile_destroy(parsed);
+  secfile_destroy(cached);
+}
+
+/**
+ * Changing an included file makes the cache stale
+ */
+void test_registry_cache::invalidation()
+{
+  const auto filename = data_dir.filePath(QStringLiteral("main.ruleset"));
+
+  auto secfile = secfile_load_cached(filename, false, cache_dir);
+  QVERIFY(secfile != nullptr);
+  secfile_destroy(secfile);
+
+  write_file(data_dir.filePath(QStringLiteral("included.ruleset")),
+             "[included]\n"
+             "value = 2\n");
+  secfile = secfile_load_cached(filename, false, cache_dir);
+  QVERIFY(secfile != nullptr);
+  QCOMPARE(secfile_lookup_int_default(secfile, 0, "included.value"), 2);
+  secfile_destroy(secfile);
+
+  // Files read as strings count as included
+  write_file(data_dir.filePath(QStringLiteral("text.txt")),
+             "New, longer text");
+  secfile = secfile_load_cached(filename, false, cache_dir);
+  QVERIFY(secfile != nullptr);
+  QCOMPARE(secfile_lookup_str_default(secfile, "", "section.text"),
+           "New, longer text");
+  secfile_destroy(secfile);
+}
+
+QTEST_GUILESS_MAIN(test_registry_cache)
+#include "test_registry_cache.moc"